@@ -0,0 +1,15 @@
+# turns a spir-v binary into a constexpr uint32_t array
+# usage: cmake -DINPUT=shader.vert.spv -DOUTPUT=shader.vert.inc -DSYMBOL=shader_vert_spv -P EmbedSpirv.cmake
+
+file(READ ${INPUT} hex HEX)
+string(LENGTH "${hex}" length)
+math(EXPR remainder "${length} % 8")
+if(length EQUAL 0 OR NOT remainder EQUAL 0)
+	message(FATAL_ERROR "${INPUT} is empty or isn't a multiple of 4 bytes")
+endif()
+
+# spir-v is little endian, so each group of 4 bytes is reversed into one word
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " words "${hex}")
+string(REGEX REPLACE "((0x........, ){8})" "\\1\n\t" words "${words}")
+
+file(WRITE ${OUTPUT} "// generated from ${INPUT}, do not edit\nalignas(4) constexpr uint32_t ${SYMBOL}[] =\n{\n\t${words}\n};\n")
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+
+inline void* AlignedAlloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	void* pointer = 0;
+	return posix_memalign(&pointer, alignment, size) == 0 ? pointer : 0;
+#endif
+}
+
+
+inline void AlignedFree(void* pointer)
+{
+#ifdef _WIN32
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+
+//keeps vector storage aligned for full width simd loads, operator new only guarantees 16 bytes before c++17
+template<typename T, size_t Alignment>
+struct AlignedAllocator
+{
+	typedef T value_type;
+	template<typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() = default;
+	template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+		void* pointer = AlignedAlloc(count * sizeof(T), Alignment);
+		if(!pointer)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(pointer);
+	}
+	void deallocate(T* pointer, size_t) { AlignedFree(pointer); }
+};
+
+template<typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+template<typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
+
+template<typename T, size_t Alignment = 32>
+using AlignedVector = std::vector<T, AlignedAllocator<T, Alignment>>;
@@ -0,0 +1,438 @@
+#include <iostream>
+#include <algorithm>
+
+#include "allocator.hpp"
+
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+void DeviceAllocator::Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount)
+{
+	this->device = device;
+	this->frameCount = std::max(frameCount, 1u);
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+	rings.resize(memProperties.memoryTypeCount);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+	maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+}
+
+
+void DeviceAllocator::Destroy()
+{
+	for(uint32_t x = 0; x < blocks.size(); ++x)
+	{
+		if(blocks[x].memory)
+		{
+			FreeBlock(x);
+		}
+	}
+	blocks.clear();
+	rings.clear();
+}
+
+
+uint32_t DeviceAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for(uint32_t x = 0; x < memProperties.memoryTypeCount; ++x)
+	{
+		if(typeFilter & (1 << x) && (memProperties.memoryTypes[x].propertyFlags & properties) == properties)
+		{
+			return x;
+		}
+	}
+
+	return 0xFFFFFFFF;
+}
+
+
+bool DeviceAllocator::Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool optimalImage,
+							   AllocationStrategy strategy, Allocation &allocation)
+{
+	const uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, properties);
+	if(memoryType == 0xFFFFFFFF)
+	{
+		std::cout << "No suitable memory type found!\n";
+		return false;
+	}
+
+	if(strategy == AllocationStrategy::Linear && !optimalImage)
+	{
+		return AllocateFromRing(memoryType, requirements.size, requirements.alignment, allocation);
+	}
+
+	//images start and end on granularity pages, so no buffer can ever share a page with one
+	VkDeviceSize size = requirements.size;
+	VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+	if(optimalImage)
+	{
+		alignment = std::max(alignment, bufferImageGranularity);
+		size = AlignUp(size, bufferImageGranularity);
+	}
+
+	uint32_t blockIndex = 0xFFFFFFFF;
+	VkDeviceSize offset = 0;
+
+	if(size > blockSize / 2)
+	{
+		//oversized resources get a block of their own instead of wasting most of a shared one
+		if(!CreateBlock(memoryType, size, true, blockIndex))
+		{
+			return false;
+		}
+		blocks[blockIndex].freeList.clear();
+	}
+	else
+	{
+		for(uint32_t x = 0; x < blocks.size(); ++x)
+		{
+			Block &block = blocks[x];
+			if(block.memory && block.memoryType == memoryType && !block.dedicated && !block.ring
+			   && AllocateFromFreeList(block, size, alignment, offset))
+			{
+				blockIndex = x;
+				break;
+			}
+		}
+
+		if(blockIndex == 0xFFFFFFFF)
+		{
+			if(!CreateBlock(memoryType, blockSize, false, blockIndex))
+			{
+				return false;
+			}
+			AllocateFromFreeList(blocks[blockIndex], size, alignment, offset);
+		}
+	}
+
+	Block &block = blocks[blockIndex];
+	block.used += size;
+	++block.allocationCount;
+
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.mapped = block.mapped ? block.mapped + offset : 0;
+	allocation.block = blockIndex;
+	allocation.strategy = AllocationStrategy::FreeList;
+	return true;
+}
+
+
+void DeviceAllocator::Free(Allocation &allocation)
+{
+	if(!allocation.memory || allocation.strategy == AllocationStrategy::Linear)
+	{
+		allocation = Allocation();
+		return;
+	}
+
+	Block &block = blocks[allocation.block];
+	block.used -= allocation.size;
+	--block.allocationCount;
+
+	//insert sorted and merge with both neighbours
+	auto it = std::lower_bound(block.freeList.begin(), block.freeList.end(), allocation.offset,
+							   [](const FreeRange &range, VkDeviceSize offset) { return range.offset < offset; });
+	it = block.freeList.insert(it, {allocation.offset, allocation.size});
+	if(it + 1 != block.freeList.end() && it->offset + it->size == (it + 1)->offset)
+	{
+		it->size += (it + 1)->size;
+		block.freeList.erase(it + 1);
+	}
+	if(it != block.freeList.begin() && (it - 1)->offset + (it - 1)->size == it->offset)
+	{
+		(it - 1)->size += it->size;
+		block.freeList.erase(it);
+	}
+
+	if(!block.allocationCount)
+	{
+		//keep one empty block per memory type around so alloc/free patterns don't thrash vkAllocateMemory.
+		//dedicated blocks don't count, small allocations can't use them
+		bool otherBlock = false;
+		for(uint32_t x = 0; x < blocks.size(); ++x)
+		{
+			if(x != allocation.block && blocks[x].memory && blocks[x].memoryType == block.memoryType && !blocks[x].ring && !blocks[x].dedicated)
+			{
+				otherBlock = true;
+			}
+		}
+		if(block.dedicated || otherBlock)
+		{
+			FreeBlock(allocation.block);
+		}
+	}
+
+	allocation = Allocation();
+}
+
+
+bool DeviceAllocator::CreateBuffer(const VkBufferCreateInfo &bufferInfo, VkMemoryPropertyFlags properties, AllocationStrategy strategy,
+								   VkBuffer &buffer, Allocation &allocation)
+{
+	if(vkCreateBuffer(device, &bufferInfo, 0, &buffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	if(!Allocate(memRequirements, properties, false, strategy, allocation))
+	{
+		vkDestroyBuffer(device, buffer, 0);
+		buffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+	return true;
+}
+
+
+bool DeviceAllocator::CreateImage(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, Allocation &allocation)
+{
+	if(vkCreateImage(device, &imageInfo, 0, &image) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+	if(!Allocate(memRequirements, properties, imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL, AllocationStrategy::FreeList, allocation))
+	{
+		vkDestroyImage(device, image, 0);
+		image = VK_NULL_HANDLE;
+		return false;
+	}
+
+	vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+	return true;
+}
+
+
+void DeviceAllocator::DestroyBuffer(VkBuffer &buffer, Allocation &allocation)
+{
+	if(buffer)
+	{
+		vkDestroyBuffer(device, buffer, 0);
+		buffer = VK_NULL_HANDLE;
+	}
+	Free(allocation);
+}
+
+
+void DeviceAllocator::DestroyImage(VkImage &image, Allocation &allocation)
+{
+	if(image)
+	{
+		vkDestroyImage(device, image, 0);
+		image = VK_NULL_HANDLE;
+	}
+	Free(allocation);
+}
+
+
+void DeviceAllocator::BeginFrame(uint32_t frame)
+{
+	//frames retire in order, so once this one is done everything up to
+	//the start of the oldest frame still in flight can be reused
+	for(auto &v : rings)
+	{
+		if(v.block != 0xFFFFFFFF)
+		{
+			v.frameStart[frame] = v.head;
+			v.tail = v.frameStart[(frame + 1) % frameCount];
+		}
+	}
+}
+
+
+AllocatorStats DeviceAllocator::GetStats() const
+{
+	AllocatorStats stats;
+
+	for(const auto &v : blocks)
+	{
+		if(!v.memory)
+		{
+			continue;
+		}
+
+		++stats.blockCount;
+		stats.reserved += v.size;
+		if(v.ring)
+		{
+			continue;
+		}
+
+		stats.used += v.used;
+		stats.allocationCount += v.allocationCount;
+		for(const auto &w : v.freeList)
+		{
+			stats.totalFree += w.size;
+			stats.largestFree = std::max(stats.largestFree, w.size);
+		}
+	}
+
+	for(const auto &v : rings)
+	{
+		if(v.block != 0xFFFFFFFF)
+		{
+			stats.used += v.head - v.tail;
+		}
+	}
+
+	if(stats.totalFree)
+	{
+		stats.fragmentation = 1.0f - float(stats.largestFree) / float(stats.totalFree);
+	}
+	return stats;
+}
+
+
+void DeviceAllocator::PrintStats() const
+{
+	const AllocatorStats stats = GetStats();
+	std::cout << "GPU memory: " << stats.used / 1024 << " KiB used of " << stats.reserved / 1024 << " KiB reserved in "
+			  << stats.blockCount << " blocks, " << stats.allocationCount << " allocations, "
+			  << stats.fragmentation * 100.0f << "% fragmented\n";
+}
+
+
+bool DeviceAllocator::CreateBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated, uint32_t &blockIndex)
+{
+	if(liveBlockCount >= maxAllocationCount)
+	{
+		std::cout << "maxMemoryAllocationCount reached!\n";
+		return false;
+	}
+
+	Block block;
+	block.size = size;
+	block.memoryType = memoryType;
+	block.dedicated = dedicated;
+	block.freeList.push_back({0, size});
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if(vkAllocateMemory(device, &allocInfo, 0, &block.memory) != VK_SUCCESS)
+	{
+		std::cout << "vkAllocateMemory of " << size / 1024 << " KiB failed\n";
+		return false;
+	}
+
+	if(memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* mapped;
+		vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+		block.mapped = static_cast<uint8_t*>(mapped);
+	}
+
+	++liveBlockCount;
+
+	for(uint32_t x = 0; x < blocks.size(); ++x)
+	{
+		if(!blocks[x].memory)
+		{
+			blocks[x] = std::move(block);
+			blockIndex = x;
+			return true;
+		}
+	}
+
+	blocks.push_back(std::move(block));
+	blockIndex = blocks.size() - 1;
+	return true;
+}
+
+
+void DeviceAllocator::FreeBlock(uint32_t blockIndex)
+{
+	//freeing implicitly unmaps
+	vkFreeMemory(device, blocks[blockIndex].memory, 0);
+	blocks[blockIndex] = Block();
+	--liveBlockCount;
+}
+
+
+bool DeviceAllocator::AllocateFromFreeList(Block &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+{
+	//first fit, the padding in front of the aligned offset stays free
+	for(auto it = block.freeList.begin(); it != block.freeList.end(); ++it)
+	{
+		const VkDeviceSize aligned = AlignUp(it->offset, alignment);
+		const VkDeviceSize end = it->offset + it->size;
+		if(aligned + size > end)
+		{
+			continue;
+		}
+
+		offset = aligned;
+		const FreeRange before = {it->offset, aligned - it->offset};
+		const FreeRange after = {aligned + size, end - aligned - size};
+
+		it = block.freeList.erase(it);
+		if(after.size)
+		{
+			it = block.freeList.insert(it, after);
+		}
+		if(before.size)
+		{
+			block.freeList.insert(it, before);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+
+bool DeviceAllocator::AllocateFromRing(uint32_t memoryType, VkDeviceSize size, VkDeviceSize alignment, Allocation &allocation)
+{
+	Ring &ring = rings[memoryType];
+	if(ring.block == 0xFFFFFFFF)
+	{
+		if(!CreateBlock(memoryType, linearBlockSize, false, ring.block))
+		{
+			return false;
+		}
+		blocks[ring.block].ring = true;
+		blocks[ring.block].freeList.clear();
+		ring.frameStart.assign(frameCount, 0);
+	}
+
+	const Block &block = blocks[ring.block];
+	VkDeviceSize offset = AlignUp(ring.head, std::max<VkDeviceSize>(alignment, 1));
+	if(offset % block.size + size > block.size)
+	{
+		//doesn't fit before the end, wrap around to the start of the block
+		offset = AlignUp(offset, block.size);
+	}
+	if(offset + size - ring.tail > block.size)
+	{
+		std::cout << "Linear allocator ring is full, linearBlockSize is too small for one frame's worth of data\n";
+		return false;
+	}
+	ring.head = offset + size;
+
+	allocation.memory = block.memory;
+	allocation.offset = offset % block.size;
+	allocation.size = size;
+	allocation.mapped = block.mapped ? block.mapped + allocation.offset : 0;
+	allocation.block = ring.block;
+	allocation.strategy = AllocationStrategy::Linear;
+	return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+
+enum class AllocationStrategy
+{
+	FreeList, //long lived resources, freed one at a time
+	Linear, //transient data, bump allocated from a ring and reclaimed a whole frame at a time
+};
+
+struct Allocation
+{
+	VkDeviceMemory memory = 0;
+	VkDeviceSize offset = 0, size = 0;
+	void* mapped = 0; //set when the memory type is host visible, blocks stay mapped for their lifetime
+	uint32_t block = 0;
+	AllocationStrategy strategy = AllocationStrategy::FreeList;
+};
+
+struct AllocatorStats
+{
+	VkDeviceSize reserved = 0, used = 0;
+	VkDeviceSize largestFree = 0, totalFree = 0;
+	uint32_t blockCount = 0, allocationCount = 0;
+	float fragmentation = 0.0f; //1 - largest free range / all free space, over free list blocks
+};
+
+//takes large VkDeviceMemory blocks per memory type and hands out aligned pieces of them,
+//so vkAllocateMemory (and maxMemoryAllocationCount) scales with blocks instead of resources
+class DeviceAllocator
+{
+	public:
+		void Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t frameCount);
+		void Destroy();
+
+		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+		//optimalImage marks non-linear resources, which are kept on bufferImageGranularity pages of their own
+		bool Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool optimalImage,
+					  AllocationStrategy strategy, Allocation &allocation);
+		void Free(Allocation &allocation);
+
+		bool CreateBuffer(const VkBufferCreateInfo &bufferInfo, VkMemoryPropertyFlags properties, AllocationStrategy strategy,
+						  VkBuffer &buffer, Allocation &allocation);
+		bool CreateImage(const VkImageCreateInfo &imageInfo, VkMemoryPropertyFlags properties, VkImage &image, Allocation &allocation);
+		void DestroyBuffer(VkBuffer &buffer, Allocation &allocation);
+		void DestroyImage(VkImage &image, Allocation &allocation);
+
+		//call once frame's fence has signalled, before allocating for it again.
+		//linear allocations made the last time this frame ran are reclaimed
+		void BeginFrame(uint32_t frame);
+
+		AllocatorStats GetStats() const;
+		void PrintStats() const;
+
+		VkDeviceSize blockSize = 64 << 20;
+		VkDeviceSize linearBlockSize = 16 << 20;
+
+	private:
+		struct FreeRange
+		{
+			VkDeviceSize offset, size;
+		};
+
+		struct Block
+		{
+			VkDeviceMemory memory = 0;
+			VkDeviceSize size = 0, used = 0;
+			uint8_t* mapped = 0;
+			uint32_t memoryType = 0;
+			uint32_t allocationCount = 0;
+			bool dedicated = false;
+			bool ring = false;
+			std::vector<FreeRange> freeList; //sorted by offset, neighbours always merged
+		};
+
+		//head and tail only ever grow, the offset in the block is the value modulo its size
+		struct Ring
+		{
+			uint32_t block = 0xFFFFFFFF;
+			VkDeviceSize head = 0, tail = 0;
+			std::vector<VkDeviceSize> frameStart;
+		};
+
+		bool CreateBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated, uint32_t &blockIndex);
+		void FreeBlock(uint32_t blockIndex);
+		bool AllocateFromFreeList(Block &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+		bool AllocateFromRing(uint32_t memoryType, VkDeviceSize size, VkDeviceSize alignment, Allocation &allocation);
+
+		std::vector<Block> blocks; //freed blocks keep their slot with memory = 0
+		std::vector<Ring> rings; //one per memory type
+		uint32_t frameCount = 1;
+
+		VkDevice device = 0;
+		VkPhysicalDeviceMemoryProperties memProperties;
+		VkDeviceSize bufferImageGranularity = 1;
+		uint32_t maxAllocationCount = 4096;
+		uint32_t liveBlockCount = 0;
+};
@@ -0,0 +1,258 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "vulkan.hpp"
+#include "benchutil.hpp"
+
+
+int main(int argc, char* argv[])
+{
+	Vulkan vulkan;
+	vulkan.headless = true;
+	vulkan.validation = false;
+	uint32_t frameCount = 1000, warmupCount = 100;
+	std::string outputPath;
+	bool dynamic = false;
+
+	for(int x = 1; x < argc; ++x)
+	{
+		const std::string arg = argv[x];
+		if(arg == "--window")
+		{
+			vulkan.headless = false;
+		}
+		else if(arg == "--frames" && x + 1 < argc)
+		{
+			frameCount = std::max(1ul, std::strtoul(argv[++x], 0, 10));
+		}
+		else if(arg == "--warmup" && x + 1 < argc)
+		{
+			warmupCount = std::strtoul(argv[++x], 0, 10);
+		}
+		else if(arg == "--dynamic")
+		{
+			dynamic = true;
+		}
+		else if(arg == "--validation")
+		{
+			vulkan.validation = true;
+		}
+		else if(arg == "--output" && x + 1 < argc)
+		{
+			outputPath = argv[++x];
+		}
+		else if(!vulkan.ParseOption(argc, argv, x))
+		{
+			std::cout << "usage: " << argv[0] << " [--window] [--frames n] [--warmup n] " << Vulkan::OptionUsage() << " [--dynamic] [--validation] [--output file.json]\n";
+			return 1;
+		}
+	}
+
+	GLFWwindow* window = 0;
+	if(!vulkan.headless)
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		window = glfwCreateWindow(800, 600, "benchmark", 0, 0);
+	}
+
+	//startup, one entry per group of init stages
+	std::vector<std::pair<const char*, double>> stages;
+	const auto startupBegin = Clock::now();
+	auto stageBegin = startupBegin;
+	auto EndStage = [&](const char* name)
+	{
+		const auto now = Clock::now();
+		stages.push_back({name, Milliseconds(stageBegin, now)});
+		stageBegin = now;
+	};
+
+	vulkan.CreateInstance();
+	vulkan.SetupDebugCallback();
+	if(!vulkan.headless)
+	{
+		vulkan.CreateSurface(window);
+	}
+	EndStage("instance");
+
+	vulkan.PickPhysicalDevice();
+	vulkan.CreateLogicalDevice();
+	EndStage("device");
+
+	if(vulkan.headless)
+	{
+		vulkan.CreateOffscreenTarget();
+	}
+	else
+	{
+		vulkan.CreateSwapchain();
+	}
+	vulkan.CreateImageViews();
+	EndStage("swapchain");
+
+	if(!vulkan.CreateRenderPass())
+	{
+		vulkan.Destroy();
+		if(!vulkan.headless)
+		{
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+		return 1;
+	}
+	vulkan.CreateGraphicsPipeline();
+	EndStage("pipeline");
+
+	vulkan.CreateFramebuffers();
+	vulkan.CreateCommandPool();
+	vulkan.CreateVertexBuffers();
+	vulkan.CreateParticles();
+	vulkan.CreateCommandBuffers();
+	vulkan.CreateSemaphores();
+	EndStage("command_buffers");
+
+	vulkan.DrawFrame();
+	vulkan.WaitIdle();
+	EndStage("first_frame");
+	const double startupTotal = Milliseconds(startupBegin, Clock::now());
+
+	//steady state, frame time is the interval between consecutive DrawFrame returns
+	for(uint32_t x = 0; x < warmupCount; ++x)
+	{
+		if(!vulkan.headless)
+		{
+			glfwPollEvents();
+		}
+		vulkan.SampleInput();
+		vulkan.DrawFrame();
+	}
+
+	//--dynamic changes the number of draws every frame to measure what scene changes cost each record mode
+	const std::vector<DrawCommand> fullDrawList = vulkan.GetDrawList();
+	std::vector<DrawCommand> drawList;
+
+	const std::pair<size_t, size_t> latencyStart(vulkan.GetLatencySamples().inputToPresent.size(), vulkan.GetLatencySamples().inputToGpuEnd.size());
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frameCount);
+	const auto loopBegin = Clock::now();
+	auto last = loopBegin;
+
+	for(uint32_t x = 0; x < frameCount; ++x)
+	{
+		if(!vulkan.headless)
+		{
+			glfwPollEvents();
+		}
+		vulkan.SampleInput();
+		if(dynamic)
+		{
+			drawList.assign(fullDrawList.begin(), fullDrawList.begin() + 1 + x % fullDrawList.size());
+			vulkan.SetDrawList(drawList);
+		}
+		vulkan.DrawFrame();
+
+		const auto now = Clock::now();
+		frameTimes.push_back(Milliseconds(last, now));
+		last = now;
+	}
+
+	vulkan.WaitIdle();
+	const double loopTotal = Milliseconds(loopBegin, Clock::now());
+	const std::string deviceName = vulkan.GetDeviceName();
+	const std::string presentMode = vulkan.GetPresentModeName();
+	const LatencySamples latency = vulkan.GetLatencySamples();
+	const AllocatorStats memory = vulkan.GetMemoryStats();
+
+	vulkan.Destroy();
+	if(!vulkan.headless)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	double mean = 0.0;
+	for(const auto &v : frameTimes)
+	{
+		mean += v;
+	}
+	mean /= frameTimes.size();
+	std::sort(frameTimes.begin(), frameTimes.end());
+
+	std::ofstream oFile;
+	std::ostream* output = OpenOutput(outputPath, oFile);
+	if(!output)
+	{
+		return 1;
+	}
+	std::ostream &out = *output;
+
+	out << std::fixed << std::setprecision(4);
+	out << "{\n";
+	out << "  \"device\": \"" << deviceName << "\",\n";
+	out << "  \"headless\": " << (vulkan.headless ? "true" : "false") << ",\n";
+	out << "  \"frames_in_flight\": " << vulkan.maxFramesInFlight << ",\n";
+	out << "  \"present_mode\": \"" << presentMode << "\",\n";
+	out << "  \"instances\": " << vulkan.instanceCount << ",\n";
+	out << "  \"instances_per_draw\": " << vulkan.instancesPerDraw << ",\n";
+	out << "  \"particles\": " << vulkan.particleCount << ",\n";
+	out << "  \"gpu_culling\": " << (vulkan.gpuCulling ? "true" : "false") << ",\n";
+	const char* recordModes[] = {"prerecorded", "per_frame", "parallel"};
+	out << "  \"record_mode\": \"" << recordModes[int(vulkan.recordMode)] << "\",\n";
+	out << "  \"dynamic\": " << (dynamic ? "true" : "false") << ",\n";
+	out << "  \"bindless\": " << (vulkan.bindless ? "true" : "false") << ",\n";
+	out << "  \"textures\": " << vulkan.texturePaths.size() << ",\n";
+	out << "  \"texture_budget_kib\": " << (vulkan.textureBudget >> 10) << ",\n";
+	out << "  \"startup_ms\": {";
+	for(const auto &v : stages)
+	{
+		out << "\"" << v.first << "\": " << v.second << ", ";
+	}
+	out << "\"total\": " << startupTotal << "},\n";
+	out << "  \"frames\": " << frameTimes.size() << ",\n";
+	out << "  \"fps\": " << frameTimes.size() / (loopTotal / 1000.0) << ",\n";
+	out << "  \"frame_ms\": {\"mean\": " << mean
+		<< ", \"p50\": " << Percentile(frameTimes, 0.50)
+		<< ", \"p99\": " << Percentile(frameTimes, 0.99)
+		<< ", \"max\": " << frameTimes.back() << "},\n";
+	if(vulkan.measureLatency)
+	{
+		//warmup frames are left out, same as the frame times
+		auto WriteLatency = [&](const char* name, std::vector<double> samples, size_t first)
+		{
+			samples.erase(samples.begin(), samples.begin() + std::min(first, samples.size()));
+			out << "\"" << name << "\": ";
+			if(samples.empty())
+			{
+				out << "null";
+				return;
+			}
+			std::sort(samples.begin(), samples.end());
+			out << "{\"p50\": " << Percentile(samples, 0.50) << ", \"p99\": " << Percentile(samples, 0.99) << ", \"max\": " << samples.back() << "}";
+		};
+
+		out << "  \"latency_ms\": {";
+		WriteLatency("input_to_present", latency.inputToPresent, latencyStart.first);
+		out << ", ";
+		WriteLatency("input_to_gpu_end", latency.inputToGpuEnd, latencyStart.second);
+		out << "},\n";
+	}
+	out << "  \"gpu_memory\": {\"reserved\": " << memory.reserved
+		<< ", \"used\": " << memory.used
+		<< ", \"blocks\": " << memory.blockCount
+		<< ", \"allocations\": " << memory.allocationCount
+		<< ", \"fragmentation\": " << memory.fragmentation << "}\n";
+	out << "}\n";
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+
+//what the benchmark executables share for timing and writing their results
+typedef std::chrono::steady_clock Clock;
+
+inline double Milliseconds(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+//sorted has to be sorted and not empty
+inline double Percentile(const std::vector<double> &sorted, double p)
+{
+	const size_t index = std::min(sorted.size() - 1, size_t(p * sorted.size()));
+	return sorted[index];
+}
+
+
+//stdout when path is empty, otherwise file opened on it. null when it can't be opened
+inline std::ostream* OpenOutput(const std::string &path, std::ofstream &file)
+{
+	if(path.empty())
+	{
+		return &std::cout;
+	}
+
+	file.open(path.c_str(), std::ios::out | std::ios::trunc);
+	if(!file)
+	{
+		std::cout << "Couldn't open " << path << " for writing\n";
+		return 0;
+	}
+	return &file;
+}
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+#include "scene.hpp"
+#include "vecmath.hpp"
+#include "benchutil.hpp"
+
+
+//objects spread through a cube around the camera, roughly a tenth of them end up in view
+static void CreateScene(uint32_t count, uint32_t seed, Scene &scene)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f), radius(0.5f, 2.0f), component(-1.0f, 1.0f);
+
+	scene.Clear();
+	scene.Reserve(count);
+	for(uint32_t x = 0; x < count; ++x)
+	{
+		const float p[3] = {position(random), position(random), position(random)};
+		float q[4] = {component(random), component(random), component(random), component(random)};
+		const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		for(auto &v : q)
+		{
+			v /= length;
+		}
+		scene.Add(p, q, 1.0f, radius(random));
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	uint32_t iterations = 100, seed = 1;
+	std::vector<uint32_t> counts{10000, 100000, 1000000};
+	std::string outputPath;
+
+	for(int x = 1; x < argc; ++x)
+	{
+		const std::string arg = argv[x];
+		if(arg == "--iterations" && x + 1 < argc)
+		{
+			iterations = std::max(1ul, std::strtoul(argv[++x], 0, 10));
+		}
+		else if(arg == "--objects" && x + 1 < argc)
+		{
+			counts.assign(1, std::strtoul(argv[++x], 0, 10));
+		}
+		else if(arg == "--seed" && x + 1 < argc)
+		{
+			seed = std::strtoul(argv[++x], 0, 10);
+		}
+		else if(arg == "--output" && x + 1 < argc)
+		{
+			outputPath = argv[++x];
+		}
+		else
+		{
+			std::cout << "usage: " << argv[0] << " [--iterations n] [--objects n] [--seed n] [--output file.json]\n";
+			return 1;
+		}
+	}
+
+	const Mat4 projection = Perspective(1.0471976f, 16.0f / 9.0f, 0.1f, 150.0f);
+	const Frustum frustum = Frustum::FromMatrix(projection.m);
+
+	//every kernel up to the best one compiled in, checked against the scalar kernel's list
+	std::vector<CullKernel> kernels;
+	for(int x = int(CullKernel::Scalar); x <= int(BestCullKernel()); ++x)
+	{
+		kernels.push_back(CullKernel(x));
+	}
+
+	struct Result
+	{
+		uint32_t objects, visible;
+		std::vector<double> median, p99; //ms per cull, per kernel
+		bool match;
+	};
+	std::vector<Result> results;
+
+	Scene scene;
+	std::vector<uint32_t> reference, visible;
+	for(const uint32_t count : counts)
+	{
+		CreateScene(count, seed, scene);
+		scene.Cull(frustum, reference, CullKernel::Scalar);
+
+		Result result = {count, uint32_t(reference.size()), {}, {}, true};
+		for(const CullKernel kernel : kernels)
+		{
+			//one untimed pass sizes the output and warms the caches
+			scene.Cull(frustum, visible, kernel);
+			result.match = result.match && visible == reference;
+
+			std::vector<double> times(iterations);
+			for(auto &v : times)
+			{
+				const auto start = Clock::now();
+				scene.Cull(frustum, visible, kernel);
+				v = Milliseconds(start, Clock::now());
+			}
+			std::sort(times.begin(), times.end());
+			result.median.push_back(Percentile(times, 0.50));
+			result.p99.push_back(Percentile(times, 0.99));
+		}
+		results.push_back(result);
+	}
+
+	std::ofstream oFile;
+	std::ostream* output = OpenOutput(outputPath, oFile);
+	if(!output)
+	{
+		return 1;
+	}
+	std::ostream &out = *output;
+
+	out << std::fixed << std::setprecision(4);
+	out << "{\n";
+	out << "  \"best_kernel\": \"" << CullKernelName(BestCullKernel()) << "\",\n";
+	out << "  \"iterations\": " << iterations << ",\n";
+	out << "  \"results\": [\n";
+	for(uint32_t x = 0; x < results.size(); ++x)
+	{
+		const Result &result = results[x];
+		out << "    {\"objects\": " << result.objects << ", \"visible\": " << result.visible
+			<< ", \"match\": " << (result.match ? "true" : "false") << ", \"cull_ms\": {";
+		for(uint32_t y = 0; y < kernels.size(); ++y)
+		{
+			out << (y ? ", " : "") << "\"" << CullKernelName(kernels[y]) << "\": {\"p50\": " << result.median[y] << ", \"p99\": " << result.p99[y] << "}";
+		}
+		out << "}, \"speedup\": " << result.median[0] / std::max(result.median.back(), 1e-9) << "}" << (x + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+
+	for(const auto &v : results)
+	{
+		if(!v.match)
+		{
+			std::cout << "Kernels disagree on " << v.objects << " objects!\n";
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,396 @@
+#include <iostream>
+#include <algorithm>
+#include <array>
+
+#include "descriptors.hpp"
+
+
+void DescriptorAllocator::Create(VkDevice device, const std::vector<VkDescriptorPoolSize> &setSizes, uint32_t setsPerPool)
+{
+	this->device = device;
+	this->setsPerPool = std::max(setsPerPool, 1u);
+
+	poolSizes = setSizes;
+	for(auto &v : poolSizes)
+	{
+		v.descriptorCount *= this->setsPerPool;
+	}
+}
+
+
+void DescriptorAllocator::Destroy()
+{
+	//one call per pool frees every set in it
+	for(auto &v : pools)
+	{
+		vkDestroyDescriptorPool(device, v, 0);
+	}
+	pools.clear();
+}
+
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	if(!pools.empty())
+	{
+		allocInfo.descriptorPool = pools.back();
+		const VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+		if(result == VK_SUCCESS)
+		{
+			return set;
+		}
+		else if(result != VK_ERROR_OUT_OF_POOL_MEMORY_KHR && result != VK_ERROR_FRAGMENTED_POOL)
+		{
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	//full, move on to a new pool
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = setsPerPool;
+	poolInfo.poolSizeCount = poolSizes.size();
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if(vkCreateDescriptorPool(device, &poolInfo, 0, &pool) != VK_SUCCESS)
+	{
+		std::cout << "Couldn't create a descriptor pool!\n";
+		return VK_NULL_HANDLE;
+	}
+	pools.push_back(pool);
+
+	allocInfo.descriptorPool = pool;
+	if(vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+	{
+		std::cout << "Descriptor set doesn't fit in an empty pool!\n";
+		return VK_NULL_HANDLE;
+	}
+	return set;
+}
+
+
+void DescriptorTable::Create(VkDevice device, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceDescriptorIndexingPropertiesEXT* indexing,
+							 uint32_t imageCapacity, uint32_t bufferCapacity)
+{
+	this->device = device;
+	bindless = indexing != 0;
+
+	//update after bind sets count against limits of their own. plain arrays count fully against
+	//the usual ones and are rewritten whole, so they're kept to fallbackCapacity as well
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	const VkPhysicalDeviceLimits &limits = properties.limits;
+	uint32_t resourceLimit;
+	if(bindless)
+	{
+		imageCapacity = std::min({imageCapacity, indexing->maxPerStageDescriptorUpdateAfterBindSampledImages, indexing->maxPerStageDescriptorUpdateAfterBindSamplers,
+								  indexing->maxDescriptorSetUpdateAfterBindSampledImages, indexing->maxDescriptorSetUpdateAfterBindSamplers});
+		bufferCapacity = std::min({bufferCapacity, indexing->maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexing->maxDescriptorSetUpdateAfterBindStorageBuffers});
+		resourceLimit = indexing->maxPerStageUpdateAfterBindResources;
+	}
+	else
+	{
+		imageCapacity = std::min({imageCapacity, fallbackCapacity, limits.maxPerStageDescriptorSampledImages, limits.maxPerStageDescriptorSamplers,
+								  limits.maxDescriptorSetSampledImages, limits.maxDescriptorSetSamplers});
+		bufferCapacity = std::min({bufferCapacity, fallbackCapacity, limits.maxPerStageDescriptorStorageBuffers, limits.maxDescriptorSetStorageBuffers});
+		resourceLimit = limits.maxPerStageResources;
+	}
+
+	//both bindings share the stage's resource limit with set 0 and the colour attachments, images get most of it
+	const uint32_t reserved = 8;
+	const uint32_t available = resourceLimit > reserved + 2 ? resourceLimit - reserved : 2;
+	if(uint64_t(imageCapacity) + bufferCapacity > available)
+	{
+		bufferCapacity = std::min(bufferCapacity, std::max(available / 4, 1u));
+		imageCapacity = std::min(imageCapacity, available - bufferCapacity);
+	}
+
+	images.assign(std::max(imageCapacity, 1u), VkDescriptorImageInfo{});
+	buffers.assign(std::max(bufferCapacity, 1u), VkDescriptorBufferInfo{});
+	imageUsed.assign(images.size(), false);
+	bufferUsed.assign(buffers.size(), false);
+	imageVersions.assign(images.size(), 0);
+	bufferVersions.assign(buffers.size(), 0);
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = images.size();
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = buffers.size();
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+	//entries not indexed by pending work can be rewritten while the set is bound
+	const VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+		| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	const std::array<VkDescriptorBindingFlagsEXT, 2> flags{bindingFlags, bindingFlags};
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo = {};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	flagsInfo.bindingCount = flags.size();
+	flagsInfo.pBindingFlags = flags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = bindings.size();
+	layoutInfo.pBindings = bindings.data();
+	if(bindless)
+	{
+		layoutInfo.pNext = &flagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	}
+	vkCreateDescriptorSetLayout(device, &layoutInfo, 0, &layout);
+
+	const std::array<VkDescriptorPoolSize, 2> poolSizes
+	{{
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, uint32_t(images.size())},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, uint32_t(buffers.size())},
+	}};
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = bindless ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = poolSizes.size();
+	poolInfo.pPoolSizes = poolSizes.data();
+	vkCreateDescriptorPool(device, &poolInfo, 0, &pool);
+
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = pool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &layout;
+	vkAllocateDescriptorSets(device, &setInfo, &set);
+}
+
+
+void DescriptorTable::Destroy()
+{
+	if(pool)
+	{
+		vkDestroyDescriptorPool(device, pool, 0);
+		vkDestroyDescriptorSetLayout(device, layout, 0);
+	}
+	pool = 0;
+	layout = 0;
+	set = 0;
+}
+
+
+uint32_t DescriptorTable::AddImage(VkImageView view, VkSampler sampler, VkImageLayout imageLayout)
+{
+	const uint32_t index = TakeSlot(imageUsed);
+	if(index != 0xFFFFFFFF)
+	{
+		images[index] = {sampler, view, imageLayout};
+		if(bindless)
+		{
+			WriteImages(set, index, 1);
+		}
+		else
+		{
+			Changed(imageVersions, imageUsed, imageFallback, index);
+		}
+	}
+	return index;
+}
+
+
+uint32_t DescriptorTable::AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	const uint32_t index = TakeSlot(bufferUsed);
+	if(index != 0xFFFFFFFF)
+	{
+		buffers[index] = {buffer, offset, range};
+		if(bindless)
+		{
+			WriteBuffers(set, index, 1);
+		}
+		else
+		{
+			Changed(bufferVersions, bufferUsed, bufferFallback, index);
+		}
+	}
+	return index;
+}
+
+
+void DescriptorTable::SetImage(uint32_t index, VkImageView view, VkSampler sampler, VkImageLayout imageLayout)
+{
+	images[index] = {sampler, view, imageLayout};
+	if(bindless)
+	{
+		WriteImages(set, index, 1);
+	}
+	else
+	{
+		Changed(imageVersions, imageUsed, imageFallback, index);
+	}
+}
+
+
+void DescriptorTable::RemoveImage(uint32_t index)
+{
+	//a partially bound set may keep the stale descriptor, nothing indexes it anymore
+	imageUsed[index] = false;
+	images[index] = {};
+	if(!bindless)
+	{
+		Changed(imageVersions, imageUsed, imageFallback, index);
+	}
+}
+
+
+void DescriptorTable::RemoveBuffer(uint32_t index)
+{
+	bufferUsed[index] = false;
+	buffers[index] = {};
+	if(!bindless)
+	{
+		Changed(bufferVersions, bufferUsed, bufferFallback, index);
+	}
+}
+
+
+void DescriptorTable::Write(VkDescriptorSet set)
+{
+	WriteImages(set, 0, images.size());
+	WriteBuffers(set, 0, buffers.size());
+}
+
+
+void DescriptorTable::Update(VkDescriptorSet set, uint32_t since)
+{
+	//one write per run of changed elements
+	for(uint32_t x = 0; x < images.size();)
+	{
+		uint32_t count = 0;
+		while(x + count < images.size() && imageVersions[x + count] > since)
+		{
+			++count;
+		}
+		if(count)
+		{
+			WriteImages(set, x, count);
+		}
+		x += std::max(count, 1u);
+	}
+	for(uint32_t x = 0; x < buffers.size();)
+	{
+		uint32_t count = 0;
+		while(x + count < buffers.size() && bufferVersions[x + count] > since)
+		{
+			++count;
+		}
+		if(count)
+		{
+			WriteBuffers(set, x, count);
+		}
+		x += std::max(count, 1u);
+	}
+}
+
+
+uint32_t DescriptorTable::TakeSlot(std::vector<bool> &used)
+{
+	const auto it = std::find(used.begin(), used.end(), false);
+	if(it == used.end())
+	{
+		std::cout << "Descriptor table is full!\n";
+		return 0xFFFFFFFF;
+	}
+	*it = true;
+	return it - used.begin();
+}
+
+
+void DescriptorTable::Changed(std::vector<uint32_t> &versions, const std::vector<bool> &used, uint32_t &fallback, uint32_t index)
+{
+	versions[index] = ++version;
+
+	//unused elements repeat the first used one, they change along with it
+	const uint32_t first = std::find(used.begin(), used.end(), true) - used.begin();
+	if(first != fallback || index == first)
+	{
+		fallback = first;
+		for(uint32_t x = 0; x < used.size(); ++x)
+		{
+			if(!used[x])
+			{
+				versions[x] = version;
+			}
+		}
+	}
+}
+
+
+void DescriptorTable::WriteImages(VkDescriptorSet set, uint32_t first, uint32_t count)
+{
+	std::vector<VkDescriptorImageInfo> infos(images.begin() + first, images.begin() + first + count);
+	if(!bindless)
+	{
+		//every element has to be valid without partially bound descriptors
+		const auto valid = std::find(imageUsed.begin(), imageUsed.end(), true);
+		if(valid == imageUsed.end())
+		{
+			return;
+		}
+		for(uint32_t x = 0; x < count; ++x)
+		{
+			if(!imageUsed[first + x])
+			{
+				infos[x] = images[valid - imageUsed.begin()];
+			}
+		}
+	}
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 0;
+	write.dstArrayElement = first;
+	write.descriptorCount = count;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = infos.data();
+	vkUpdateDescriptorSets(device, 1, &write, 0, 0);
+}
+
+
+void DescriptorTable::WriteBuffers(VkDescriptorSet set, uint32_t first, uint32_t count)
+{
+	std::vector<VkDescriptorBufferInfo> infos(buffers.begin() + first, buffers.begin() + first + count);
+	if(!bindless)
+	{
+		const auto valid = std::find(bufferUsed.begin(), bufferUsed.end(), true);
+		if(valid == bufferUsed.end())
+		{
+			return;
+		}
+		for(uint32_t x = 0; x < count; ++x)
+		{
+			if(!bufferUsed[first + x])
+			{
+				infos[x] = buffers[valid - bufferUsed.begin()];
+			}
+		}
+	}
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = 1;
+	write.dstArrayElement = first;
+	write.descriptorCount = count;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = infos.data();
+	vkUpdateDescriptorSets(device, 1, &write, 0, 0);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+
+//descriptor sets that live until Destroy, which frees them together with their pools instead
+//of one at a time. a full pool is followed by another one, so any number of sets can be allocated.
+//not thread safe
+class DescriptorAllocator
+{
+	public:
+		//setSizes is what one set may need at most, each pool holds setsPerPool of those
+		void Create(VkDevice device, const std::vector<VkDescriptorPoolSize> &setSizes, uint32_t setsPerPool = 64);
+		//the gpu has to be done with every set allocated
+		void Destroy();
+
+		//VK_NULL_HANDLE only when a fresh pool can't hold the layout either
+		VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+		uint32_t PoolCount() const { return pools.size(); }
+
+	private:
+		//the last pool is the one being allocated from
+		std::vector<VkDescriptorPool> pools;
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		uint32_t setsPerPool = 0;
+
+		VkDevice device = 0;
+};
+
+//one large set holding every sampled image (binding 0) and storage buffer (binding 1), so
+//draws select resources by index instead of binding sets of their own.
+//with descriptor indexing the set is update after bind and partially bound: entries are written
+//as they're added, and the set is bound once and never replaced. without it the table is only
+//a list, Write copies it into a set that isn't in use and Update brings such a copy up to date
+//(unused array elements repeat the first entry)
+class DescriptorTable
+{
+	public:
+		//indexing is the device's descriptor indexing limits, null makes a plain set. capacities are clamped
+		//to the update after bind limits with it and to the usual per stage and per set ones without
+		void Create(VkDevice device, VkPhysicalDevice physicalDevice, const VkPhysicalDeviceDescriptorIndexingPropertiesEXT* indexing,
+					uint32_t imageCapacity, uint32_t bufferCapacity);
+		void Destroy();
+
+		//the index shaders use, 0xFFFFFFFF when the table is full
+		uint32_t AddImage(VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uint32_t AddBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+		//points an index at another view. with descriptor indexing the bound set is written right away,
+		//so like RemoveImage no frame in flight may still read the index. a fresh AddImage index doesn't need that
+		void SetImage(uint32_t index, VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		//the index is reused by the next add, no frame in flight may still read it
+		void RemoveImage(uint32_t index);
+		void RemoveBuffer(uint32_t index);
+
+		//writes every entry into set, which uses Layout() and mustn't be in use by the gpu
+		void Write(VkDescriptorSet set);
+		//writes the entries changed since set was current at Version() since, same rules as Write
+		void Update(VkDescriptorSet set, uint32_t since);
+		//moves on with every change a copy made by Write misses, never with descriptor indexing
+		uint32_t Version() const { return version; }
+
+		bool Bindless() const { return bindless; }
+		VkDescriptorSetLayout Layout() const { return layout; }
+		VkDescriptorSet Set() const { return set; } //the table's own set, already current when bindless
+		uint32_t ImageCapacity() const { return images.size(); }
+		uint32_t BufferCapacity() const { return buffers.size(); }
+
+		uint32_t fallbackCapacity = 128; //per binding without descriptor indexing
+
+	private:
+		static uint32_t TakeSlot(std::vector<bool> &used);
+		void Changed(std::vector<uint32_t> &versions, const std::vector<bool> &used, uint32_t &fallback, uint32_t index);
+		void WriteImages(VkDescriptorSet set, uint32_t first, uint32_t count);
+		void WriteBuffers(VkDescriptorSet set, uint32_t first, uint32_t count);
+
+		std::vector<VkDescriptorImageInfo> images;
+		std::vector<VkDescriptorBufferInfo> buffers;
+		std::vector<bool> imageUsed, bufferUsed;
+		std::vector<uint32_t> imageVersions, bufferVersions; //the version each element last changed at
+		uint32_t imageFallback = 0, bufferFallback = 0; //first used element, what unused ones repeat
+		bool bindless = false;
+		uint32_t version = 0;
+
+		VkDevice device = 0;
+		VkDescriptorSetLayout layout = 0;
+		VkDescriptorPool pool = 0;
+		VkDescriptorSet set = 0;
+};
@@ -1,90 +1,279 @@
-#include <fstream>
-#include <sstream>
 #include <iostream>
 #include <vector>
 #include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
 
 #include "file.hpp"
 
 
-const std::vector<uint8_t> FileToU8Vec(const std::string inFile)
+const char* FileErrorString(FileError error)
 {
-	std::ifstream iFile(inFile.c_str(), std::ios::in | std::ios::binary);
-	if(iFile.is_open() == false)
+	switch(error)
 	{
-		std::cout << "File not found" << std::endl;
-		exit(0);
+		case FileError::None: return "no error";
+		case FileError::NotFound: return "file not found";
+		case FileError::Empty: return "file is empty";
+		case FileError::MapFailed: return "mapping the file failed";
 	}
+	return "unknown error";
+}
+
 
-	std::ostringstream contents;
-    contents << iFile.rdbuf();
-	iFile.close();
+MappedFile::MappedFile(MappedFile &&other)
+{
+	*this = std::move(other);
+}
 
-	const std::string contentStr = contents.str();
-	const std::vector<uint8_t> contentVec(contentStr.begin(), contentStr.end());
 
-	return contentVec;
+MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+	if(this != &other)
+	{
+		Close();
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+#ifdef _WIN32
+		std::swap(mapping, other.mapping);
+#endif
+	}
+	return *this;
 }
 
 
-const std::vector<uint32_t> FileToU32Vec(const std::string inFile)
+MappedFile::~MappedFile()
 {
-	std::ifstream iFile(inFile.c_str(), std::ios::in | std::ios::binary);
-	if(iFile.is_open() == false)
+	Close();
+}
+
+
+FileError MappedFile::Open(const std::string &path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return FileError::NotFound;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
 	{
-		std::cout << "File not found" << std::endl;
-		exit(0);
+		CloseHandle(file);
+		return FileError::Empty;
 	}
 
-	std::ostringstream contents;
-    contents << iFile.rdbuf();
-	iFile.close();
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file); //the mapping keeps its own reference
+	if(!mapping)
+	{
+		return FileError::MapFailed;
+	}
 
-	const std::string contentStr = contents.str();
-	if(!contentStr.size())
+	data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if(!data)
 	{
-		std::cout << inFile << " is empty!\n";
-		// return false;
+		CloseHandle(mapping);
+		mapping = 0;
+		return FileError::MapFailed;
 	}
-	if(contentStr.size() % 4 != 0)
+	size = fileSize.QuadPart;
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		return FileError::NotFound;
+	}
+
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
 	{
-		std::cout << inFile << " isn't a multiple of 4 bytes!";
-		// return false;
+		close(fd);
+		return FileError::Empty;
 	}
-	std::vector<uint32_t> contentVec(contentStr.size() / 4);
-	std::memcpy(contentVec.data(), contentStr.data(), contentStr.size());
 
-	return contentVec;
+	void* mapped = mmap(0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //the mapping keeps its own reference
+	if(mapped == MAP_FAILED)
+	{
+		return FileError::MapFailed;
+	}
+
+	data = static_cast<const uint8_t*>(mapped);
+	size = fileStat.st_size;
+#endif
+
+	return FileError::None;
+}
+
+
+void MappedFile::Close()
+{
+	if(!data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	mapping = 0;
+#else
+	munmap(const_cast<uint8_t*>(data), size);
+#endif
+	data = 0;
+	size = 0;
+}
+
+
+const uint32_t* MappedFile::Words() const
+{
+	if(size % 4 != 0)
+	{
+		return 0;
+	}
+	return reinterpret_cast<const uint32_t*>(data);
 }
 
 
-// const bool FileToU32Vec(const std::string inFile, std::vector<uint32_t> &contentVec)
-// {
-	// std::ifstream iFile(inFile.c_str(), std::ios::in | std::ios::binary);
-	// if(iFile.is_open() == false)
-	// {
-		// std::cout << "File not found\n";
-		// return false;
-	// }
-
-	// std::ostringstream contents;
-    // contents << iFile.rdbuf();
-	// iFile.close();
-
-	// const std::string contentStr = contents.str();
-	// if(!contentStr.size())
-	// {
-		// std::cout << inFile << " is empty!\n";
-		// return false;
-	// }
-	// if(contentStr.size() % 4 != 0)
-	// {
-		// std::cout << inFile << " isn't a multiple of 4 bytes!\n";
-		// return false;
-	// }
-
-	// contentVec.resize(contentStr.size() / 4);
-	// std::memcpy(contentVec.data(), contentStr.data(), contentStr.size());
-
-	// return true;
-// }
+void MappedFile::Prefetch(size_t offset, size_t length) const
+{
+#ifndef _WIN32
+	if(offset >= size)
+	{
+		return;
+	}
+	length = std::min(length, size - offset);
+
+	//madvise wants a page aligned start
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	const size_t alignedOffset = offset & ~(pageSize - 1);
+	madvise(const_cast<uint8_t*>(data) + alignedOffset, length + offset - alignedOffset, MADV_WILLNEED);
+#endif
+}
+
+
+void MappedFile::AdviseSequential() const
+{
+#ifndef _WIN32
+	if(data)
+	{
+		madvise(const_cast<uint8_t*>(data), size, MADV_SEQUENTIAL);
+	}
+#endif
+}
+
+
+void PrefetchFiles(const std::vector<std::string> &paths)
+{
+#ifndef _WIN32
+	for(const auto &v : paths)
+	{
+		const int fd = open(v.c_str(), O_RDONLY);
+		if(fd >= 0)
+		{
+			//queues the reads and returns, the page cache keeps the data after close
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			close(fd);
+		}
+	}
+#endif
+}
+
+
+const bool U8VecToFile(const std::string outFile, const std::vector<uint8_t> &contentVec)
+{
+	//write everything to a temp file first and rename it over the target,
+	//so a crash halfway through never leaves a truncated file behind
+	const std::string tempFile = outFile + ".tmp";
+
+#ifdef _WIN32
+	const HANDLE file = CreateFileA(tempFile.c_str(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	size_t written = 0;
+	while(written < contentVec.size())
+	{
+		DWORD result = 0;
+		const DWORD chunk = DWORD(std::min<size_t>(contentVec.size() - written, 1 << 30));
+		if(!WriteFile(file, contentVec.data() + written, chunk, &result, 0) || !result)
+		{
+			CloseHandle(file);
+			std::remove(tempFile.c_str());
+			return false;
+		}
+		written += result;
+	}
+
+	//MOVEFILE_WRITE_THROUGH only covers the move, the data has to be on disk before it or a crash can leave an empty file
+	const bool flushed = FlushFileBuffers(file) != 0;
+	CloseHandle(file);
+	if(!flushed || !MoveFileExA(tempFile.c_str(), outFile.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		std::remove(tempFile.c_str());
+		return false;
+	}
+	return true;
+#else
+	const int fd = open(tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	size_t written = 0;
+	while(written < contentVec.size())
+	{
+		const ssize_t result = write(fd, contentVec.data() + written, contentVec.size() - written);
+		if(result <= 0)
+		{
+			close(fd);
+			std::remove(tempFile.c_str());
+			return false;
+		}
+		written += result;
+	}
+
+	//data has to be on disk before the rename is, or a crash can still leave an empty file
+	const bool synced = fsync(fd) == 0;
+	close(fd);
+	if(!synced || std::rename(tempFile.c_str(), outFile.c_str()) != 0)
+	{
+		std::remove(tempFile.c_str());
+		return false;
+	}
+
+	//the rename itself only lives in the directory entry, which needs its own fsync to survive a crash.
+	//some filesystems can't sync directories (EINVAL), the rename is as durable as they make it then.
+	//the new file is in place either way, a failure only costs durability
+	const size_t slash = outFile.find_last_of('/');
+	const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : outFile.substr(0, slash);
+	const int directoryFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	const bool directorySynced = directoryFd >= 0 && (fsync(directoryFd) == 0 || errno == EINVAL);
+	if(directoryFd >= 0)
+	{
+		close(directoryFd);
+	}
+	if(!directorySynced)
+	{
+		std::cout << "Couldn't sync " << directory << ", " << outFile << " may not survive a crash\n";
+	}
+	return true;
+#endif
+}
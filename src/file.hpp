@@ -1,6 +1,58 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
 
-const std::vector<uint8_t> FileToU8Vec(const std::string inFile);
-const std::vector<uint32_t> FileToU32Vec(const std::string inFile);
-// const bool FileToU32Vec(const std::string inFile, std::vector<uint32_t> &contentVec);
+
+enum class FileError
+{
+	None,
+	NotFound,
+	Empty,
+	MapFailed,
+};
+
+const char* FileErrorString(FileError error);
+
+//read-only view of a memory mapped file. nothing is copied, pages are read in
+//the first time they're touched and shared with the os file cache
+class MappedFile
+{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile &operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile &&other);
+		MappedFile &operator=(MappedFile &&other);
+		~MappedFile();
+
+		FileError Open(const std::string &path);
+		void Close();
+
+		const uint8_t* Data() const { return data; }
+		size_t Size() const { return size; }
+
+		//mappings start on a page boundary, so the data can be used as words (spir-v)
+		//directly. null if the size isn't a multiple of 4
+		const uint32_t* Words() const;
+
+		//hints for large assets, both are no-ops where the os has no equivalent
+		void Prefetch(size_t offset = 0, size_t length = SIZE_MAX) const; //start reading pages in the background
+		void AdviseSequential() const; //aggressive readahead, pages can be dropped once read
+
+	private:
+		const uint8_t* data = 0;
+		size_t size = 0;
+#ifdef _WIN32
+		void* mapping = 0;
+#endif
+};
+
+//starts readahead for a whole asset set without mapping anything yet
+void PrefetchFiles(const std::vector<std::string> &paths);
+
+//atomic, via temp file + rename, synced along with its directory. false only when the target
+//wasn't replaced, a directory that can't be synced is reported but the new file stays
+const bool U8VecToFile(const std::string outFile, const std::vector<uint8_t> &contentVec);
@@ -3,43 +3,145 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
 
 #include "main.hpp"
 #include "vulkan.hpp"
 
 
-int main()
+int main(int argc, char* argv[])
 {
-	glfwInit();
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	GLFWwindow* window = glfwCreateWindow(800, 600, "test", 0, 0);
-
 	Vulkan vulkan;
 	vulkan.verbose = true;
+	uint32_t frameLimit = 0;
+
+	for(int x = 1; x < argc; ++x)
+	{
+		const std::string arg = argv[x];
+		if(arg == "--headless")
+		{
+			vulkan.headless = true;
+		}
+		else if(arg == "--frames" && x + 1 < argc)
+		{
+			frameLimit = std::strtoul(argv[++x], 0, 10);
+		}
+		else if(arg == "--trace" && x + 1 < argc)
+		{
+			vulkan.tracePath = argv[++x];
+		}
+		else if(arg == "--shader-dir" && x + 1 < argc)
+		{
+			vulkan.shaderDir = argv[++x];
+		}
+		else if(!vulkan.ParseOption(argc, argv, x))
+		{
+			std::cout << "usage: " << argv[0] << " [--headless] [--frames n] " << Vulkan::OptionUsage() << " [--trace file.json] [--shader-dir dir]\n";
+			return 1;
+		}
+	}
+
+	if(vulkan.headless && !frameLimit)
+	{
+		frameLimit = 1000;
+	}
+
+	GLFWwindow* window = 0;
+	if(!vulkan.headless)
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+		window = glfwCreateWindow(800, 600, "test", 0, 0);
+		glfwSetWindowUserPointer(window, &vulkan);
+		glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height)
+		{
+			static_cast<Vulkan*>(glfwGetWindowUserPointer(window))->framebufferResized = true;
+		});
+	}
+
 	// vulkan.PrintAvailableExtensions();
 	vulkan.CreateInstance();
 	vulkan.SetupDebugCallback();
-	vulkan.CreateSurface(window);
+	if(!vulkan.headless)
+	{
+		vulkan.CreateSurface(window);
+	}
 	vulkan.PickPhysicalDevice();
 	vulkan.CreateLogicalDevice();
-	vulkan.CreateSwapchain();
+	if(vulkan.headless)
+	{
+		vulkan.CreateOffscreenTarget();
+	}
+	else
+	{
+		vulkan.CreateSwapchain();
+	}
 	vulkan.CreateImageViews();
-	vulkan.CreateRenderPass();
+	if(!vulkan.CreateRenderPass())
+	{
+		vulkan.Destroy();
+		if(!vulkan.headless)
+		{
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+		return 1;
+	}
 	vulkan.CreateGraphicsPipeline();
 	vulkan.CreateFramebuffers();
 	vulkan.CreateCommandPool();
+	vulkan.CreateVertexBuffers();
+	vulkan.CreateParticles();
 	vulkan.CreateCommandBuffers();
 	vulkan.CreateSemaphores();
 
-	while(!glfwWindowShouldClose(window))
+	const auto start = std::chrono::steady_clock::now();
+	uint32_t frames = 0;
+
+	while((vulkan.headless || !glfwWindowShouldClose(window)) && (!frameLimit || frames < frameLimit))
 	{
-		glfwPollEvents();
+		if(!vulkan.headless)
+		{
+			glfwPollEvents();
+		}
+		vulkan.SampleInput();
 		vulkan.DrawFrame();
+		++frames;
+	}
+
+	vulkan.WaitIdle();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << frames << " frames in " << seconds << "s (" << frames / seconds << " fps)\n";
+
+	const LatencySamples &latency = vulkan.GetLatencySamples();
+	if(!latency.inputToPresent.empty())
+	{
+		double present = 0.0, gpu = 0.0;
+		for(const auto &v : latency.inputToPresent)
+		{
+			present += v;
+		}
+		for(const auto &v : latency.inputToGpuEnd)
+		{
+			gpu += v;
+		}
+		std::cout << "latency (" << vulkan.GetPresentModeName() << "): input to present " << present / latency.inputToPresent.size() << "ms";
+		if(!latency.inputToGpuEnd.empty())
+		{
+			std::cout << ", input to gpu end " << gpu / latency.inputToGpuEnd.size() << "ms";
+		}
+		std::cout << "\n";
 	}
 
 	vulkan.Destroy();
-	glfwDestroyWindow(window);
-	glfwTerminate();
+
+	if(!vulkan.headless)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
 	return 0;
 }
@@ -0,0 +1,259 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+#include "vecmath.hpp"
+#include "benchutil.hpp"
+
+
+//what the batch kernels replace: array of structures, plain float arrays and textbook loops
+struct NaiveTransform
+{
+	float position[3], rotation[4], scale[3];
+};
+
+
+static void NaiveMultiply(const float* a, const float* b, float* out)
+{
+	for(uint32_t column = 0; column < 4; ++column)
+	{
+		for(uint32_t row = 0; row < 4; ++row)
+		{
+			float sum = 0.0f;
+			for(uint32_t x = 0; x < 4; ++x)
+			{
+				sum += a[x * 4 + row] * b[column * 4 + x];
+			}
+			out[column * 4 + row] = sum;
+		}
+	}
+}
+
+
+//translation * rotation * scale as three matrices
+static void NaiveCompose(const NaiveTransform &transform, float* out)
+{
+	const float* q = transform.rotation;
+	float translation[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, transform.position[0], transform.position[1], transform.position[2], 1};
+	float rotation[16] = {
+		1 - 2 * (q[1] * q[1] + q[2] * q[2]), 2 * (q[0] * q[1] + q[3] * q[2]), 2 * (q[0] * q[2] - q[3] * q[1]), 0,
+		2 * (q[0] * q[1] - q[3] * q[2]), 1 - 2 * (q[0] * q[0] + q[2] * q[2]), 2 * (q[1] * q[2] + q[3] * q[0]), 0,
+		2 * (q[0] * q[2] + q[3] * q[1]), 2 * (q[1] * q[2] - q[3] * q[0]), 1 - 2 * (q[0] * q[0] + q[1] * q[1]), 0,
+		0, 0, 0, 1};
+	float scale[16] = {transform.scale[0], 0, 0, 0, 0, transform.scale[1], 0, 0, 0, 0, transform.scale[2], 0, 0, 0, 0, 1};
+	float rotationScale[16];
+	NaiveMultiply(rotation, scale, rotationScale);
+	NaiveMultiply(translation, rotationScale, out);
+}
+
+
+//largest difference relative to the element's size, the naive code sums in another order
+static float MaxError(const std::vector<float> &naive, const Mat4* batch)
+{
+	float error = 0.0f;
+	for(size_t x = 0; x < naive.size(); ++x)
+	{
+		const float value = batch[x / 16].m[x % 16];
+		error = std::max(error, std::fabs(naive[x] - value) / std::max(1.0f, std::fabs(naive[x])));
+	}
+	return error;
+}
+
+
+int main(int argc, char* argv[])
+{
+	uint32_t iterations = 100, seed = 1;
+	std::vector<uint32_t> counts{10000, 100000};
+	std::string outputPath;
+
+	for(int x = 1; x < argc; ++x)
+	{
+		const std::string arg = argv[x];
+		if(arg == "--iterations" && x + 1 < argc)
+		{
+			iterations = std::max(1ul, std::strtoul(argv[++x], 0, 10));
+		}
+		else if(arg == "--transforms" && x + 1 < argc)
+		{
+			counts.assign(1, std::strtoul(argv[++x], 0, 10));
+		}
+		else if(arg == "--seed" && x + 1 < argc)
+		{
+			seed = std::strtoul(argv[++x], 0, 10);
+		}
+		else if(arg == "--output" && x + 1 < argc)
+		{
+			outputPath = argv[++x];
+		}
+		else
+		{
+			std::cout << "usage: " << argv[0] << " [--iterations n] [--transforms n] [--seed n] [--output file.json]\n";
+			return 1;
+		}
+	}
+
+	const char* operations[] = {"compose", "multiply", "propagate", "propagate_upload"};
+	const uint32_t operationCount = sizeof(operations) / sizeof(operations[0]);
+	struct Timing
+	{
+		double median, p99; //ms per batch
+	};
+	struct Result
+	{
+		uint32_t transforms;
+		Timing naive[4], batch[4];
+		float error[4];
+	};
+	std::vector<Result> results;
+
+	const auto Time = [&](const std::function<void()> &work)
+	{
+		//one untimed pass warms the caches
+		work();
+		std::vector<double> times(iterations);
+		for(auto &v : times)
+		{
+			const auto start = Clock::now();
+			work();
+			v = Milliseconds(start, Clock::now());
+		}
+		std::sort(times.begin(), times.end());
+		return Timing{Percentile(times, 0.50), Percentile(times, 0.99)};
+	};
+
+	for(const uint32_t count : counts)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-10.0f, 10.0f), scale(0.5f, 2.0f), component(-1.0f, 1.0f);
+
+		//hierarchies of 64 nodes, each node's parent somewhere earlier in its hierarchy
+		std::vector<NaiveTransform> naiveTransforms(count);
+		TransformArrays transforms;
+		transforms.Resize(count);
+		std::vector<int32_t> parents(count);
+		for(uint32_t x = 0; x < count; ++x)
+		{
+			const Vec3 p = {position(random), position(random), position(random)};
+			const Quat q = Normalize(Quat{component(random), component(random), component(random), component(random)});
+			const Vec3 s = {scale(random), scale(random), scale(random)};
+			naiveTransforms[x] = {{p.x, p.y, p.z}, {q.x, q.y, q.z, q.w}, {s.x, s.y, s.z}};
+			transforms.Set(x, p, q, s);
+
+			const uint32_t root = x & ~63u;
+			parents[x] = x == root ? -1 : int32_t(std::uniform_int_distribution<uint32_t>(root, x - 1)(random));
+		}
+
+		//out stands in for a mapped per frame buffer, the kernels only ever store to it
+		std::vector<Mat4> local(count), other(count), world(count), out(count);
+		std::vector<float> naiveLocal(count * 16), naiveOther(count * 16), naiveOut(count * 16);
+		ComposeTransforms(transforms, local.data());
+		std::reverse_copy(local.begin(), local.end(), other.begin());
+		for(uint32_t x = 0; x < count; ++x)
+		{
+			NaiveCompose(naiveTransforms[x], &naiveLocal[x * 16]);
+		}
+		for(uint32_t x = 0; x < count; ++x)
+		{
+			std::copy(naiveLocal.begin() + (count - 1 - x) * 16, naiveLocal.begin() + (count - x) * 16, naiveOther.begin() + x * 16);
+		}
+
+		Result result = {};
+		result.transforms = count;
+
+		result.naive[0] = Time([&]()
+		{
+			for(uint32_t x = 0; x < count; ++x)
+			{
+				NaiveCompose(naiveTransforms[x], &naiveOut[x * 16]);
+			}
+		});
+		result.batch[0] = Time([&]() { ComposeTransforms(transforms, out.data()); });
+		result.error[0] = MaxError(naiveOut, out.data());
+
+		result.naive[1] = Time([&]()
+		{
+			for(uint32_t x = 0; x < count; ++x)
+			{
+				NaiveMultiply(&naiveLocal[x * 16], &naiveOther[x * 16], &naiveOut[x * 16]);
+			}
+		});
+		result.batch[1] = Time([&]() { MultiplyMatrices(local.data(), other.data(), out.data(), count); });
+		result.error[1] = MaxError(naiveOut, out.data());
+
+		//the naive hierarchy works in its own output like the batch one does in world. with an upload
+		//the batch one writes out as well, which the naive code never does
+		const auto NaivePropagate = [&]()
+		{
+			for(uint32_t x = 0; x < count; ++x)
+			{
+				if(parents[x] < 0)
+				{
+					std::copy(&naiveLocal[x * 16], &naiveLocal[x * 16] + 16, &naiveOut[x * 16]);
+				}
+				else
+				{
+					NaiveMultiply(&naiveOut[parents[x] * 16], &naiveLocal[x * 16], &naiveOut[x * 16]);
+				}
+			}
+		};
+		result.naive[2] = Time(NaivePropagate);
+		result.batch[2] = Time([&]() { PropagateHierarchy(parents.data(), local.data(), world.data(), count); });
+		result.error[2] = MaxError(naiveOut, world.data());
+
+		result.naive[3] = result.naive[2];
+		result.batch[3] = Time([&]() { PropagateHierarchy(parents.data(), local.data(), world.data(), count, out.data()); });
+		result.error[3] = MaxError(naiveOut, out.data());
+
+		results.push_back(result);
+	}
+
+	std::ofstream oFile;
+	std::ostream* output = OpenOutput(outputPath, oFile);
+	if(!output)
+	{
+		return 1;
+	}
+	std::ostream &out = *output;
+
+	out << std::fixed << std::setprecision(4);
+	out << "{\n";
+	out << "  \"kernel\": \"" << MathKernelName() << "\",\n";
+	out << "  \"iterations\": " << iterations << ",\n";
+	out << "  \"results\": [\n";
+	for(uint32_t x = 0; x < results.size(); ++x)
+	{
+		const Result &result = results[x];
+		out << "    {\"transforms\": " << result.transforms;
+		for(uint32_t y = 0; y < operationCount; ++y)
+		{
+			out << ", \"" << operations[y] << "\": {\"naive\": {\"p50\": " << result.naive[y].median << ", \"p99\": " << result.naive[y].p99
+				<< "}, \"batch\": {\"p50\": " << result.batch[y].median << ", \"p99\": " << result.batch[y].p99
+				<< "}, \"speedup\": " << result.naive[y].median / std::max(result.batch[y].median, 1e-9)
+				<< ", \"max_error\": " << std::scientific << result.error[y] << std::fixed << "}";
+		}
+		out << "}" << (x + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+
+	for(const auto &v : results)
+	{
+		for(uint32_t x = 0; x < operationCount; ++x)
+		{
+			if(!(v.error[x] < 1e-4f))
+			{
+				std::cout << "Batch " << operations[x] << " disagrees with the naive code on " << v.transforms << " transforms!\n";
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,191 @@
+#include <array>
+#include <chrono>
+#include <iostream>
+
+#include "pipelines.hpp"
+
+
+void PipelineBuilder::Create(VkDevice device, VkPipelineCache cache, ShaderLoader &&loadShader, uint32_t threadCount)
+{
+	this->device = device;
+	this->cache = cache;
+	this->loadShader = std::move(loadShader);
+	threadPool.Create(threadCount);
+}
+
+
+void PipelineBuilder::Destroy()
+{
+	//workers drain the queue before they exit
+	threadPool.Destroy();
+
+	for(const auto &v : built)
+	{
+		const VkPipeline pipeline = v.get();
+		if(pipeline)
+		{
+			vkDestroyPipeline(device, pipeline, 0);
+		}
+	}
+	built.clear();
+}
+
+
+PipelineHandle PipelineBuilder::Submit(const PipelineVariant &variant)
+{
+	PipelineHandle handle = threadPool.Submit([this, variant]() { return Build(variant); }).share();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	built.push_back(handle);
+	return handle;
+}
+
+
+std::vector<PipelineHandle> PipelineBuilder::Submit(const std::vector<PipelineVariant> &variants)
+{
+	std::vector<PipelineHandle> handles;
+	handles.reserve(variants.size());
+	for(const auto &v : variants)
+	{
+		handles.push_back(Submit(v));
+	}
+	return handles;
+}
+
+
+VkPipeline PipelineBuilder::TryGet(const PipelineHandle &handle)
+{
+	if(!handle.valid() || handle.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return VK_NULL_HANDLE;
+	}
+	return handle.get();
+}
+
+
+VkPipeline PipelineBuilder::Build(const PipelineVariant &variant)
+{
+	VkShaderModule vertShaderModule, fragShaderModule;
+	loadShader(variant.vertexShader, vertShaderModule);
+	loadShader(variant.fragmentShader, fragShaderModule);
+	if(!vertShaderModule || !fragShaderModule)
+	{
+		vkDestroyShaderModule(device, vertShaderModule, 0);
+		vkDestroyShaderModule(device, fragShaderModule, 0);
+		return VK_NULL_HANDLE;
+	}
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = variant.constants.size();
+	specializationInfo.pMapEntries = variant.constants.data();
+	specializationInfo.dataSize = variant.constantData.size();
+	specializationInfo.pData = variant.constantData.data();
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1] = shaderStages[0];
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragShaderModule;
+	if(!variant.constants.empty())
+	{
+		shaderStages[0].pSpecializationInfo = &specializationInfo;
+		shaderStages[1].pSpecializationInfo = &specializationInfo;
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = variant.bindings.size();
+	vertexInputInfo.pVertexBindingDescriptions = variant.bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = variant.attributes.size();
+	vertexInputInfo.pVertexAttributeDescriptions = variant.attributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = variant.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	//both are dynamic, only the counts matter
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = variant.cullMode;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.0f;
+
+	//equal passes, so draws at the same depth still land in submission order
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = variant.blend ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = variant.blend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = variant.blend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	const std::array<VkDynamicState, 2> dynamicStates{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = dynamicStates.size();
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = shaderStages.size();
+	pipelineInfo.pStages = shaderStages.data();
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = variant.depthTest ? &depthStencil : 0;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = variant.layout;
+	pipelineInfo.renderPass = variant.renderPass;
+	pipelineInfo.subpass = variant.subpass;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if(vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, 0, &pipeline) != VK_SUCCESS)
+	{
+		std::cout << "Pipeline " << variant.vertexShader << " / " << variant.fragmentShader << " failed to compile\n";
+		pipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule(device, vertShaderModule, 0);
+	vkDestroyShaderModule(device, fragShaderModule, 0);
+	return pipeline;
+}
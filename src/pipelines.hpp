@@ -0,0 +1,83 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "threadpool.hpp"
+
+
+//everything that differs between graphics pipelines built from the same render pass.
+//viewport and scissor are always dynamic, so no variant depends on the swapchain size
+struct PipelineVariant
+{
+	std::string vertexShader = "shader.vert", fragmentShader = "shader.frag";
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	bool blend = false; //alpha blending, off writes the colour straight through
+	bool depthTest = false; //tests and writes depth, the render pass needs a depth attachment for it
+	VkPipelineLayout layout = 0;
+	VkRenderPass renderPass = 0;
+	uint32_t subpass = 0;
+
+	//specialization constants, shared by both stages. a constant_id missing from a shader is ignored
+	std::vector<VkSpecializationMapEntry> constants;
+	std::vector<uint8_t> constantData;
+
+	template<typename T>
+	void SetConstant(uint32_t id, const T &value)
+	{
+		const uint32_t offset = constantData.size();
+		constantData.resize(offset + sizeof(T));
+		std::memcpy(constantData.data() + offset, &value, sizeof(T));
+		constants.push_back({id, offset, sizeof(T)});
+	}
+};
+
+//ready once the pipeline is compiled, VK_NULL_HANDLE if that failed
+typedef std::shared_future<VkPipeline> PipelineHandle;
+
+//compiles pipeline variants on its own worker threads, so a batch builds in parallel and
+//rarely used variants can still be compiling while the first frames are drawn.
+//every job shares the one VkPipelineCache, which vulkan synchronizes internally
+class PipelineBuilder
+{
+	public:
+		typedef std::function<void(const std::string&, VkShaderModule&)> ShaderLoader;
+
+		PipelineBuilder() = default;
+		PipelineBuilder(const PipelineBuilder&) = delete;
+		PipelineBuilder &operator=(const PipelineBuilder&) = delete;
+
+		//loadShader is called from the workers. 0 threads uses one per hardware thread
+		void Create(VkDevice device, VkPipelineCache cache, ShaderLoader &&loadShader, uint32_t threadCount = 0);
+		//waits for everything still compiling, then destroys every pipeline built
+		void Destroy();
+
+		PipelineHandle Submit(const PipelineVariant &variant);
+		std::vector<PipelineHandle> Submit(const std::vector<PipelineVariant> &variants);
+
+		//blocks until done
+		static VkPipeline Get(const PipelineHandle &handle) { return handle.valid() ? handle.get() : VK_NULL_HANDLE; }
+		//VK_NULL_HANDLE while still compiling, for callers that can skip a draw instead of stalling
+		static VkPipeline TryGet(const PipelineHandle &handle);
+
+	private:
+		VkPipeline Build(const PipelineVariant &variant);
+
+		ThreadPool threadPool;
+		ShaderLoader loadShader;
+		std::vector<PipelineHandle> built;
+		std::mutex mutex;
+
+		VkDevice device = 0;
+		VkPipelineCache cache = 0;
+};
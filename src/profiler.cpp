@@ -0,0 +1,213 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "profiler.hpp"
+
+
+void Profiler::Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t slotCount)
+{
+	this->device = device;
+	epoch = Clock::now();
+	enabled = true;
+	slots.resize(slotCount);
+
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, 0);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	const uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+	if(!validBits)
+	{
+		std::cout << "Queue family has no timestamp support, only cpu events will be traced\n";
+		return;
+	}
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = slotCount * maxZonesPerSlot * 2;
+
+	vkCreateQueryPool(device, &queryPoolInfo, 0, &queryPool);
+}
+
+
+void Profiler::Destroy()
+{
+	if(queryPool)
+	{
+		vkDestroyQueryPool(device, queryPool, 0);
+		queryPool = 0;
+	}
+	enabled = false;
+}
+
+
+void Profiler::CmdBeginFrame(VkCommandBuffer cmd, uint32_t slot)
+{
+	if(!queryPool || slot >= slots.size())
+	{
+		return;
+	}
+
+	slots[slot].zones.clear();
+	vkCmdResetQueryPool(cmd, queryPool, slot * maxZonesPerSlot * 2, maxZonesPerSlot * 2);
+}
+
+
+uint32_t Profiler::CmdBeginZone(VkCommandBuffer cmd, uint32_t slot, const char* name, VkPipelineStageFlagBits stage)
+{
+	if(!queryPool || slot >= slots.size() || slots[slot].zones.size() >= maxZonesPerSlot)
+	{
+		return 0xFFFFFFFF;
+	}
+
+	const uint32_t zone = slots[slot].zones.size();
+	const uint32_t query = (slot * maxZonesPerSlot + zone) * 2;
+	slots[slot].zones.push_back({name, query});
+
+	vkCmdWriteTimestamp(cmd, stage, queryPool, query);
+	return zone;
+}
+
+
+void Profiler::CmdEndZone(VkCommandBuffer cmd, uint32_t slot, uint32_t zone, VkPipelineStageFlagBits stage)
+{
+	if(!queryPool || slot >= slots.size() || zone >= slots[slot].zones.size())
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(cmd, stage, queryPool, slots[slot].zones[zone].query + 1);
+}
+
+
+void Profiler::MarkSubmit(uint32_t slot)
+{
+	if(!enabled || slot >= slots.size())
+	{
+		return;
+	}
+
+	slots[slot].pending = true;
+	slots[slot].frame = frame;
+	slots[slot].submitTime = Now();
+}
+
+
+void Profiler::Collect(uint32_t slot)
+{
+	if(!queryPool || slot >= slots.size() || !slots[slot].pending)
+	{
+		return;
+	}
+
+	Slot &s = slots[slot];
+	s.pending = false;
+	s.gpuEnd = INT64_MIN;
+	if(s.zones.empty())
+	{
+		return;
+	}
+
+	//zones are allocated front to back, so one read covers the whole slot.
+	//no WAIT_BIT: the caller already waited on the fence, if the results
+	//still aren't there the frame is dropped instead of stalling
+	const uint32_t queryCount = s.zones.size() * 2;
+	results.resize(queryCount);
+	VkResult result = vkGetQueryPoolResults(device, queryPool, s.zones[0].query, queryCount, results.size() * sizeof(uint64_t),
+											results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if(result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	int64_t lastEnd = INT64_MIN;
+	for(uint32_t x = 0; x < s.zones.size(); ++x)
+	{
+		const int64_t begin = int64_t((results[x * 2] & timestampMask) * timestampPeriod);
+		const int64_t end = int64_t((results[x * 2 + 1] & timestampMask) * timestampPeriod);
+		lastEnd = std::max(lastEnd, end);
+
+		//there is no shared clock, but gpu work can't start before it was submitted.
+		//the tightest offset satisfying that for every frame seen so far is the best guess
+		gpuToCpu = std::max(gpuToCpu, s.submitTime - begin);
+		if(events.size() < maxEvents)
+		{
+			events.push_back({s.zones[x].name, s.frame, begin, std::max<int64_t>(end - begin, 0), true});
+		}
+	}
+	s.gpuEnd = lastEnd + gpuToCpu;
+}
+
+
+bool Profiler::GetGpuEnd(uint32_t slot, int64_t &time) const
+{
+	if(slot >= slots.size() || slots[slot].gpuEnd == INT64_MIN)
+	{
+		return false;
+	}
+
+	time = slots[slot].gpuEnd;
+	return true;
+}
+
+
+void Profiler::AddCpuEvent(const char* name, Clock::time_point start, Clock::time_point end)
+{
+	if(events.size() >= maxEvents)
+	{
+		return;
+	}
+
+	const int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count();
+	const int64_t durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	events.push_back({name, frame, startNs, durationNs, false});
+}
+
+
+bool Profiler::WriteTrace(const std::string &path)
+{
+	std::ofstream oFile(path.c_str(), std::ios::out | std::ios::trunc);
+	if(oFile.is_open() == false)
+	{
+		std::cout << "Couldn't open " << path << " for writing\n";
+		return false;
+	}
+
+	//chrome://tracing / perfetto trace event format, timestamps in microseconds
+	oFile << std::fixed << std::setprecision(3);
+	oFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	oFile << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	oFile << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	for(const auto &v : events)
+	{
+		const int64_t start = v.gpu ? v.start + gpuToCpu : v.start;
+		oFile << ",\n{\"name\":\"" << v.name << "\",\"cat\":\"" << (v.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\""
+			  << ",\"ts\":" << start / 1000.0 << ",\"dur\":" << v.duration / 1000.0
+			  << ",\"pid\":0,\"tid\":" << v.gpu << ",\"args\":{\"frame\":" << v.frame << "}}";
+	}
+
+	oFile << "\n]}\n";
+	return bool(oFile);
+}
+
+
+int64_t Profiler::ToTime(Clock::time_point time) const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch).count();
+}
+
+
+int64_t Profiler::Now() const
+{
+	return ToTime(Clock::now());
+}
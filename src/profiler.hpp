@@ -0,0 +1,105 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct TraceEvent
+{
+	const char* name;
+	uint64_t frame;
+	int64_t start, duration; //ns, cpu events relative to the profiler epoch, gpu events in raw gpu time
+	bool gpu;
+};
+
+class Profiler
+{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		void Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t slotCount);
+		void Destroy();
+
+		//a slot is one command buffer's worth of queries. it must not be re-recorded or
+		//resubmitted until Collect has been called for it after its fence signalled.
+		//slots past slotCount (a recreated swapchain with more images) are ignored
+		void CmdBeginFrame(VkCommandBuffer cmd, uint32_t slot);
+		uint32_t CmdBeginZone(VkCommandBuffer cmd, uint32_t slot, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		void CmdEndZone(VkCommandBuffer cmd, uint32_t slot, uint32_t zone, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+		void MarkSubmit(uint32_t slot);
+		void Collect(uint32_t slot);
+		void AddCpuEvent(const char* name, Clock::time_point start, Clock::time_point end);
+		void NextFrame() { ++frame; }
+
+		//end of the slot's last collected gpu work on the cpu timeline (ns since the epoch),
+		//as good as the gpuToCpu estimate. false until a collect succeeded
+		bool GetGpuEnd(uint32_t slot, int64_t &time) const;
+		int64_t ToTime(Clock::time_point time) const;
+
+		bool WriteTrace(const std::string &path);
+
+		bool enabled = false;
+		uint32_t maxZonesPerSlot = 16;
+		size_t maxEvents = 1 << 20; //recording stops here so long runs don't grow without bound
+
+	private:
+		struct Zone
+		{
+			const char* name;
+			uint32_t query;
+		};
+
+		struct Slot
+		{
+			std::vector<Zone> zones;
+			uint64_t frame = 0;
+			int64_t submitTime = 0;
+			int64_t gpuEnd = INT64_MIN;
+			bool pending = false;
+		};
+
+		int64_t Now() const;
+
+		std::vector<Slot> slots;
+		std::vector<TraceEvent> events;
+		std::vector<uint64_t> results;
+
+		VkDevice device = 0;
+		VkQueryPool queryPool = 0;
+		Clock::time_point epoch;
+		double timestampPeriod = 1.0;
+		uint64_t timestampMask = ~0ull;
+		int64_t gpuToCpu = INT64_MIN; //offset so every gpu zone starts after its submit
+		uint64_t frame = 0;
+};
+
+class ProfileScope
+{
+	public:
+		ProfileScope(Profiler &profiler, const char* name) : profiler(profiler), name(name)
+		{
+			if(profiler.enabled)
+			{
+				start = Profiler::Clock::now();
+			}
+		}
+
+		~ProfileScope()
+		{
+			if(profiler.enabled)
+			{
+				profiler.AddCpuEvent(name, start, Profiler::Clock::now());
+			}
+		}
+
+	private:
+		Profiler &profiler;
+		const char* name;
+		Profiler::Clock::time_point start;
+};
@@ -0,0 +1,721 @@
+#include <iostream>
+#include <algorithm>
+
+#include "rendergraph.hpp"
+
+
+static bool IsDepthFormat(VkFormat format)
+{
+	switch(format)
+	{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+static VkImageAspectFlags AspectMask(VkFormat format)
+{
+	switch(format)
+	{
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return IsDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+
+void RenderGraph::Create(VkDevice device, DeviceAllocator &allocator)
+{
+	this->device = device;
+	this->allocator = &allocator;
+}
+
+
+void RenderGraph::Destroy()
+{
+	DestroyTargets(targets);
+	for(auto &v : passes)
+	{
+		if(v.renderPass)
+		{
+			vkDestroyRenderPass(device, v.renderPass, 0);
+		}
+	}
+	passes.clear();
+	resources.clear();
+	aliasSlots.clear();
+}
+
+
+GraphResource RenderGraph::ImportImage(const std::string &name, VkFormat format, VkImageLayout finalLayout,
+									   VkImageLayout initialLayout, VkPipelineStageFlags initialStage)
+{
+	Resource resource;
+	resource.name = name;
+	resource.format = format;
+	resource.imported = true;
+	resource.output = true;
+	resource.finalLayout = finalLayout;
+	resource.initial.layout = initialLayout;
+	resource.initial.stage = initialStage;
+	resource.initial.written = initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+	resources.push_back(resource);
+	return resources.size() - 1;
+}
+
+
+GraphResource RenderGraph::CreateImage(const std::string &name, VkFormat format, VkExtent2D extent)
+{
+	Resource resource;
+	resource.name = name;
+	resource.format = format;
+	resource.extent = extent;
+	resources.push_back(resource);
+	return resources.size() - 1;
+}
+
+
+void RenderGraph::MarkOutput(GraphResource image)
+{
+	resources[image].output = true;
+}
+
+
+uint32_t RenderGraph::AddPass(const std::string &name)
+{
+	Pass pass;
+	pass.name = name;
+	passes.push_back(pass);
+	return passes.size() - 1;
+}
+
+
+void RenderGraph::WriteColor(uint32_t pass, GraphResource image, const VkClearColorValue* clear)
+{
+	Attachment attachment = {image, false, clear != 0, {}};
+	if(clear)
+	{
+		attachment.clearValue.color = *clear;
+	}
+	passes[pass].attachments.push_back(attachment);
+}
+
+
+void RenderGraph::WriteDepth(uint32_t pass, GraphResource image, const VkClearDepthStencilValue* clear)
+{
+	Attachment attachment = {image, true, clear != 0, {}};
+	if(clear)
+	{
+		attachment.clearValue.depthStencil = *clear;
+	}
+	passes[pass].attachments.push_back(attachment);
+}
+
+
+void RenderGraph::Sample(uint32_t pass, GraphResource image, VkPipelineStageFlags stages)
+{
+	passes[pass].reads.push_back({image, stages});
+}
+
+
+bool RenderGraph::Compile()
+{
+	for(const auto &v : passes)
+	{
+		uint32_t depthCount = 0;
+		for(const auto &a : v.attachments)
+		{
+			depthCount += a.depth;
+			for(const auto &r : v.reads)
+			{
+				if(r.image == a.image)
+				{
+					std::cout << "Render graph pass " << v.name << " samples its own attachment " << resources[a.image].name << "\n";
+					return false;
+				}
+			}
+		}
+		if(depthCount > 1)
+		{
+			std::cout << "Render graph pass " << v.name << " writes more than one depth attachment\n";
+			return false;
+		}
+	}
+
+	//walking back from the outputs, a pass is kept when a later one needs what it renders.
+	//a clear ends the need for earlier contents, loading or sampling carries it further back
+	std::vector<bool> needed(resources.size());
+	for(uint32_t x = 0; x < resources.size(); ++x)
+	{
+		needed[x] = resources[x].output;
+	}
+	for(uint32_t x = passes.size(); x-- > 0;)
+	{
+		Pass &pass = passes[x];
+		pass.culled = std::none_of(pass.attachments.begin(), pass.attachments.end(), [&](const Attachment &a) { return needed[a.image]; });
+		if(pass.culled)
+		{
+			continue;
+		}
+		for(const auto &a : pass.attachments)
+		{
+			needed[a.image] = !a.clear;
+		}
+		for(const auto &r : pass.reads)
+		{
+			needed[r.image] = true;
+		}
+	}
+
+	//lifetimes, usage, and how each image is left at the end of a frame
+	for(auto &v : resources)
+	{
+		v.firstPass = 0xFFFFFFFF;
+		v.lastPass = 0;
+		v.usage = 0;
+		v.stored = false;
+	}
+	std::vector<Usage> lastUse(resources.size());
+	for(uint32_t x = 0; x < passes.size(); ++x)
+	{
+		if(passes[x].culled)
+		{
+			continue;
+		}
+		for(const auto &a : passes[x].attachments)
+		{
+			Resource &resource = resources[a.image];
+			resource.firstPass = std::min(resource.firstPass, x);
+			resource.lastPass = x;
+			resource.usage |= a.depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			lastUse[a.image].stage = a.depth ? VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+											 : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			lastUse[a.image].access = a.depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+		for(const auto &r : passes[x].reads)
+		{
+			Resource &resource = resources[r.image];
+			resource.firstPass = std::min(resource.firstPass, x);
+			resource.lastPass = x;
+			resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+			lastUse[r.image].stage = r.stages;
+			lastUse[r.image].access = 0;
+		}
+	}
+
+	//greedy over owned images in order of first use. a slot is free again once its last
+	//occupant's last pass is done, one holding the same format and extent is preferred
+	std::vector<GraphResource> owned;
+	for(uint32_t x = 0; x < resources.size(); ++x)
+	{
+		if(!resources[x].imported && resources[x].firstPass != 0xFFFFFFFF)
+		{
+			owned.push_back(x);
+		}
+	}
+	std::stable_sort(owned.begin(), owned.end(), [&](GraphResource a, GraphResource b) { return resources[a].firstPass < resources[b].firstPass; });
+
+	aliasSlots.clear();
+	for(const GraphResource v : owned)
+	{
+		const Resource &resource = resources[v];
+		std::vector<GraphResource>* slot = 0;
+		for(auto &s : aliasSlots)
+		{
+			const Resource &last = resources[s.back()];
+			if(last.lastPass < resource.firstPass)
+			{
+				const bool same = last.format == resource.format && last.extent.width == resource.extent.width && last.extent.height == resource.extent.height;
+				if(!slot || same)
+				{
+					slot = &s;
+				}
+				if(same)
+				{
+					break;
+				}
+			}
+		}
+		if(!slot)
+		{
+			aliasSlots.emplace_back();
+			slot = &aliasSlots.back();
+		}
+		slot->push_back(v);
+	}
+
+	//an owned image's first use waits for whatever used its memory last: the previous occupant
+	//of its slot, or for the first one, the last occupant in the frame before
+	for(const auto &s : aliasSlots)
+	{
+		for(uint32_t x = 0; x < s.size(); ++x)
+		{
+			const GraphResource previous = s[(x + s.size() - 1) % s.size()];
+			Usage &initial = resources[s[x]].initial;
+			initial = Usage();
+			initial.stage = lastUse[previous].stage;
+			initial.access = lastUse[previous].access;
+		}
+	}
+
+	std::vector<Usage> state(resources.size());
+	for(uint32_t x = 0; x < resources.size(); ++x)
+	{
+		state[x] = resources[x].initial;
+	}
+
+	for(uint32_t x = 0; x < passes.size(); ++x)
+	{
+		Pass &pass = passes[x];
+		if(pass.renderPass)
+		{
+			vkDestroyRenderPass(device, pass.renderPass, 0);
+			pass.renderPass = 0;
+		}
+		pass.clearValues.clear();
+		pass.before.clear();
+		pass.after.clear();
+		if(pass.culled)
+		{
+			continue;
+		}
+
+		std::vector<VkAttachmentDescription> descriptions;
+		std::vector<VkAttachmentReference> colorReferences;
+		VkAttachmentReference depthReference = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+
+		//one dependency on everything the attachments and reads were last used by
+		VkSubpassDependency dependency = {};
+		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.dstSubpass = 0;
+
+		for(const auto &a : pass.attachments)
+		{
+			const Resource &resource = resources[a.image];
+			Usage &use = state[a.image];
+			const VkImageLayout layout = a.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			VkImageLayout nextLayout;
+			const bool used = NextUse(a.image, x, nextLayout) != 0xFFFFFFFF;
+
+			VkAttachmentDescription description = {};
+			description.format = resource.format;
+			description.samples = VK_SAMPLE_COUNT_1_BIT;
+			description.loadOp = a.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : use.written ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.storeOp = used || resource.output ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.stencilLoadOp = a.depth ? description.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = a.depth ? description.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.initialLayout = description.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? use.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+			description.finalLayout = used ? nextLayout : resource.imported && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? resource.finalLayout : layout;
+
+			const bool load = description.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+			dependency.srcStageMask |= use.stage;
+			dependency.srcAccessMask |= use.access;
+			if(a.depth)
+			{
+				dependency.dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | (load ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : 0);
+				depthReference = {uint32_t(descriptions.size()), layout};
+			}
+			else
+			{
+				dependency.dstStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (load ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+				colorReferences.push_back({uint32_t(descriptions.size()), layout});
+			}
+
+			descriptions.push_back(description);
+			pass.clearValues.push_back(a.clearValue);
+
+			use.layout = description.finalLayout;
+			use.stage = a.depth ? VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			use.access = a.depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			use.written = description.storeOp == VK_ATTACHMENT_STORE_OP_STORE;
+			resources[a.image].stored |= use.written;
+		}
+
+		for(const auto &r : pass.reads)
+		{
+			//rendered by an earlier pass, its render pass already left it readable
+			Usage &use = state[r.image];
+			if(use.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+			{
+				dependency.srcStageMask |= use.stage;
+				dependency.srcAccessMask |= use.access;
+				dependency.dstStageMask |= r.stages;
+				dependency.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+			}
+			else
+			{
+				pass.before.push_back({r.image, use.layout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, use.stage ? use.stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+									   r.stages, use.access, VK_ACCESS_SHADER_READ_BIT});
+			}
+			use.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			use.stage = r.stages;
+			use.access = 0;
+		}
+
+		if(!dependency.srcStageMask)
+		{
+			dependency.srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		}
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = colorReferences.size();
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.pDepthStencilAttachment = depthReference.attachment != VK_ATTACHMENT_UNUSED ? &depthReference : 0;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = descriptions.size();
+		renderPassInfo.pAttachments = descriptions.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 1;
+		renderPassInfo.pDependencies = &dependency;
+
+		if(vkCreateRenderPass(device, &renderPassInfo, 0, &pass.renderPass) != VK_SUCCESS)
+		{
+			std::cout << "Render graph pass " << pass.name << " has no valid render pass\n";
+			return false;
+		}
+	}
+
+	//owned images no pass ever stores only live inside render passes, tilers can keep them in tile memory
+	for(auto &v : resources)
+	{
+		if(!v.imported && v.firstPass != 0xFFFFFFFF && !v.stored)
+		{
+			v.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+	}
+
+	//imported images sampled last still have to end up in their final layout
+	for(uint32_t x = 0; x < resources.size(); ++x)
+	{
+		const Resource &resource = resources[x];
+		if(resource.imported && resource.firstPass != 0xFFFFFFFF && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED
+		   && state[x].layout != resource.finalLayout)
+		{
+			passes[resource.lastPass].after.push_back({x, state[x].layout, resource.finalLayout, state[x].stage,
+													   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, state[x].access, 0});
+		}
+	}
+	return true;
+}
+
+
+void RenderGraph::SetImportedImages(GraphResource image, const std::vector<VkImage> &images, const std::vector<VkImageView> &views)
+{
+	resources[image].importedImages = images;
+	resources[image].importedViews = views;
+}
+
+
+bool RenderGraph::CreateTargets(VkExtent2D extent)
+{
+	targets.extent = extent;
+	targets.instanceCount = 1;
+	for(const auto &v : resources)
+	{
+		if(v.imported && v.firstPass != 0xFFFFFFFF)
+		{
+			if(v.importedViews.empty())
+			{
+				std::cout << "Render graph image " << v.name << " was never given its views\n";
+				return false;
+			}
+			targets.instanceCount = std::max<uint32_t>(targets.instanceCount, v.importedViews.size());
+		}
+	}
+	targets.images.assign(resources.size(), VK_NULL_HANDLE);
+	targets.views.assign(resources.size(), VK_NULL_HANDLE);
+	transientSize = 0;
+	transientMemory = 0;
+
+	//a slot's images share memory, unless they have no suitable memory type in common. transient
+	//attachments prefer lazily allocated memory, which tilers may never back with real memory,
+	//and only share with each other since nothing else can be bound to it
+	const VkMemoryPropertyFlags lazy = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	for(const auto &slot : aliasSlots)
+	{
+		struct Group
+		{
+			VkMemoryRequirements requirements;
+			VkMemoryPropertyFlags properties;
+			std::vector<GraphResource> members;
+		};
+		std::vector<Group> groups;
+
+		for(const GraphResource v : slot)
+		{
+			const VkExtent2D imageExtent = Extent(v);
+
+			VkImageCreateInfo imageInfo = {};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = resources[v].format;
+			imageInfo.extent = {imageExtent.width, imageExtent.height, 1};
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = resources[v].usage;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			vkCreateImage(device, &imageInfo, 0, &targets.images[v]);
+
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(device, targets.images[v], &requirements);
+			transientSize += requirements.size;
+
+			const bool transient = (resources[v].usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+			const VkMemoryPropertyFlags properties = transient && allocator->FindMemoryType(requirements.memoryTypeBits, lazy) != 0xFFFFFFFF
+													 ? lazy : VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			const auto group = std::find_if(groups.begin(), groups.end(), [&](const Group &g)
+			{
+				return g.properties == properties && allocator->FindMemoryType(g.requirements.memoryTypeBits & requirements.memoryTypeBits, properties) != 0xFFFFFFFF;
+			});
+			if(group == groups.end())
+			{
+				groups.push_back({requirements, properties, {v}});
+			}
+			else
+			{
+				group->requirements.size = std::max(group->requirements.size, requirements.size);
+				group->requirements.alignment = std::max(group->requirements.alignment, requirements.alignment);
+				group->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+				group->members.push_back(v);
+			}
+		}
+
+		for(const auto &g : groups)
+		{
+			Allocation allocation;
+			if(!allocator->Allocate(g.requirements, g.properties, true, AllocationStrategy::FreeList, allocation))
+			{
+				std::cout << "Render graph couldn't allocate " << g.requirements.size / 1024 << "KiB for its images\n";
+				return false;
+			}
+			for(const GraphResource v : g.members)
+			{
+				vkBindImageMemory(device, targets.images[v], allocation.memory, allocation.offset);
+			}
+			targets.allocations.push_back(allocation);
+			transientMemory += g.requirements.size;
+		}
+	}
+
+	for(uint32_t x = 0; x < resources.size(); ++x)
+	{
+		if(!targets.images[x])
+		{
+			continue;
+		}
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = targets.images[x];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resources[x].format;
+		viewInfo.subresourceRange = {AspectMask(resources[x].format), 0, 1, 0, 1};
+		vkCreateImageView(device, &viewInfo, 0, &targets.views[x]);
+	}
+
+	targets.framebuffers.assign(passes.size(), std::vector<VkFramebuffer>());
+	for(uint32_t x = 0; x < passes.size(); ++x)
+	{
+		const Pass &pass = passes[x];
+		if(pass.culled)
+		{
+			continue;
+		}
+
+		const VkExtent2D passExtent = Extent(pass.attachments[0].image);
+		targets.framebuffers[x].resize(targets.instanceCount);
+		for(uint32_t y = 0; y < targets.instanceCount; ++y)
+		{
+			std::vector<VkImageView> attachments;
+			for(const auto &a : pass.attachments)
+			{
+				attachments.push_back(View(a.image, y));
+			}
+
+			VkFramebufferCreateInfo framebufferInfo = {};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = pass.renderPass;
+			framebufferInfo.attachmentCount = attachments.size();
+			framebufferInfo.pAttachments = attachments.data();
+			framebufferInfo.width = passExtent.width;
+			framebufferInfo.height = passExtent.height;
+			framebufferInfo.layers = 1;
+			vkCreateFramebuffer(device, &framebufferInfo, 0, &targets.framebuffers[x][y]);
+		}
+	}
+	return true;
+}
+
+
+RenderGraph::Targets RenderGraph::TakeTargets()
+{
+	Targets taken = std::move(targets);
+	targets = Targets();
+	return taken;
+}
+
+
+void RenderGraph::DestroyTargets(Targets &targets)
+{
+	for(const auto &v : targets.framebuffers)
+	{
+		for(const auto &w : v)
+		{
+			vkDestroyFramebuffer(device, w, 0);
+		}
+	}
+	for(uint32_t x = 0; x < targets.images.size(); ++x)
+	{
+		if(targets.images[x])
+		{
+			vkDestroyImageView(device, targets.views[x], 0);
+			vkDestroyImage(device, targets.images[x], 0);
+		}
+	}
+	for(auto &v : targets.allocations)
+	{
+		allocator->Free(v);
+	}
+	targets = Targets();
+}
+
+
+bool RenderGraph::CmdBeginPass(VkCommandBuffer cmd, uint32_t pass, uint32_t instance, VkSubpassContents contents)
+{
+	const Pass &p = passes[pass];
+	if(p.culled)
+	{
+		return false;
+	}
+	CmdBarriers(cmd, p.before, instance);
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = p.renderPass;
+	renderPassInfo.framebuffer = targets.framebuffers[pass][instance];
+	renderPassInfo.renderArea.offset = {0, 0};
+	renderPassInfo.renderArea.extent = Extent(p.attachments[0].image);
+	renderPassInfo.clearValueCount = p.clearValues.size();
+	renderPassInfo.pClearValues = p.clearValues.data();
+
+	vkCmdBeginRenderPass(cmd, &renderPassInfo, contents);
+	return true;
+}
+
+
+void RenderGraph::CmdEndPass(VkCommandBuffer cmd, uint32_t pass, uint32_t instance)
+{
+	vkCmdEndRenderPass(cmd);
+	CmdBarriers(cmd, passes[pass].after, instance);
+}
+
+
+bool RenderGraph::Aliased(GraphResource a, GraphResource b) const
+{
+	return std::any_of(aliasSlots.begin(), aliasSlots.end(), [&](const std::vector<GraphResource> &s)
+	{
+		return std::count(s.begin(), s.end(), a) && std::count(s.begin(), s.end(), b);
+	});
+}
+
+
+//the next pass after pass using image and the layout it wants, 0xFFFFFFFF when there is none
+uint32_t RenderGraph::NextUse(GraphResource image, uint32_t pass, VkImageLayout &layout) const
+{
+	for(uint32_t x = pass + 1; x < passes.size(); ++x)
+	{
+		if(passes[x].culled)
+		{
+			continue;
+		}
+		for(const auto &a : passes[x].attachments)
+		{
+			if(a.image == image)
+			{
+				layout = a.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				return x;
+			}
+		}
+		for(const auto &r : passes[x].reads)
+		{
+			if(r.image == image)
+			{
+				layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				return x;
+			}
+		}
+	}
+	return 0xFFFFFFFF;
+}
+
+
+void RenderGraph::CmdBarriers(VkCommandBuffer cmd, const std::vector<Barrier> &barriers, uint32_t instance) const
+{
+	if(barriers.empty())
+	{
+		return;
+	}
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	VkPipelineStageFlags srcStage = 0, dstStage = 0;
+	for(const auto &v : barriers)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = v.srcAccess;
+		barrier.dstAccessMask = v.dstAccess;
+		barrier.oldLayout = v.oldLayout;
+		barrier.newLayout = v.newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = Image(v.image, instance);
+		barrier.subresourceRange = {AspectMask(resources[v.image].format), 0, 1, 0, 1};
+		imageBarriers.push_back(barrier);
+
+		srcStage |= v.srcStage;
+		dstStage |= v.dstStage;
+	}
+	vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, 0, 0, 0, imageBarriers.size(), imageBarriers.data());
+}
+
+
+VkImage RenderGraph::Image(GraphResource image, uint32_t instance) const
+{
+	const Resource &resource = resources[image];
+	return resource.imported ? resource.importedImages[instance % resource.importedImages.size()] : targets.images[image];
+}
+
+
+VkImageView RenderGraph::View(GraphResource image, uint32_t instance) const
+{
+	const Resource &resource = resources[image];
+	return resource.imported ? resource.importedViews[instance % resource.importedViews.size()] : targets.views[image];
+}
+
+
+VkExtent2D RenderGraph::Extent(GraphResource image) const
+{
+	const VkExtent2D &extent = resources[image].extent;
+	return extent.width && extent.height ? extent : targets.extent;
+}
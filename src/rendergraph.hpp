@@ -0,0 +1,156 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+#include "allocator.hpp"
+
+
+typedef uint32_t GraphResource;
+
+//the frame described as passes over images instead of hand written render passes and barriers.
+//passes are added in execution order and declare the images they render to and the ones they
+//sample. Compile culls passes whose results nothing uses and derives the rest from the
+//declarations: one render pass per pass with its load and store ops, layouts and the dependency
+//on each image's previous use, plus the barriers a render pass can't express. images the graph
+//owns only live from their first to their last pass, those whose lifetimes don't overlap share memory,
+//and those no pass stores are transient attachments
+class RenderGraph
+{
+	public:
+		//framebuffers and graph owned images, rebuilt whenever the extent or the imported images change
+		struct Targets
+		{
+			VkExtent2D extent = {0, 0};
+			uint32_t instanceCount = 0;
+			std::vector<VkImage> images; //per resource, null for imported ones
+			std::vector<VkImageView> views;
+			std::vector<Allocation> allocations; //one per group of aliased images
+			std::vector<std::vector<VkFramebuffer>> framebuffers; //per pass and instance, none for culled passes
+		};
+
+		//layout changes outside a render pass, for images that are only sampled
+		struct Barrier
+		{
+			GraphResource image;
+			VkImageLayout oldLayout, newLayout;
+			VkPipelineStageFlags srcStage, dstStage;
+			VkAccessFlags srcAccess, dstAccess;
+		};
+
+		void Create(VkDevice device, DeviceAllocator &allocator);
+		//the gpu has to be done with the targets and render passes
+		void Destroy();
+
+		//an image from outside, like the swapchain's. it arrives in initialLayout once initialStage
+		//may run (the acquire semaphore's wait stage) and is left in finalLayout. always an output
+		GraphResource ImportImage(const std::string &name, VkFormat format, VkImageLayout finalLayout,
+								  VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+								  VkPipelineStageFlags initialStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		//owned by the graph, a zero extent follows the targets. contents don't outlive the frame
+		GraphResource CreateImage(const std::string &name, VkFormat format, VkExtent2D extent = {0, 0});
+		//kept even when no pass reads it
+		void MarkOutput(GraphResource image);
+
+		uint32_t AddPass(const std::string &name);
+		//clears to clear, or keeps what earlier passes rendered when it's null
+		void WriteColor(uint32_t pass, GraphResource image, const VkClearColorValue* clear = 0);
+		void WriteDepth(uint32_t pass, GraphResource image, const VkClearDepthStencilValue* clear = 0);
+		void Sample(uint32_t pass, GraphResource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+		//false when the declarations don't make a valid frame
+		bool Compile();
+
+		//every instance (swapchain image) gets its own framebuffers
+		void SetImportedImages(GraphResource image, const std::vector<VkImage> &images, const std::vector<VkImageView> &views);
+		bool CreateTargets(VkExtent2D extent);
+		//hands the current targets over, to be destroyed once no frame in flight uses them
+		Targets TakeTargets();
+		void DestroyTargets(Targets &targets);
+
+		//false for a culled pass, nothing is recorded for it
+		bool CmdBeginPass(VkCommandBuffer cmd, uint32_t pass, uint32_t instance, VkSubpassContents contents);
+		void CmdEndPass(VkCommandBuffer cmd, uint32_t pass, uint32_t instance);
+
+		VkRenderPass RenderPass(uint32_t pass) const { return passes[pass].renderPass; }
+		VkFramebuffer Framebuffer(uint32_t pass, uint32_t instance) const { return targets.framebuffers[pass][instance]; }
+		bool Culled(uint32_t pass) const { return passes[pass].culled; }
+		//for sampling an image outside the graph's passes, changes with the targets
+		VkImageView View(GraphResource image, uint32_t instance) const;
+		VkDeviceSize TransientSize() const { return transientSize; } //graph owned images added up
+		VkDeviceSize TransientMemory() const { return transientMemory; } //what they take with aliasing
+
+		//what Compile derived, for checking it. usage is 0 for images no kept pass uses
+		VkImageUsageFlags ImageUsage(GraphResource image) const { return resources[image].usage; }
+		bool Aliased(GraphResource a, GraphResource b) const;
+		uint32_t AliasSlotCount() const { return aliasSlots.size(); }
+		const std::vector<Barrier>& BarriersBefore(uint32_t pass) const { return passes[pass].before; }
+		const std::vector<Barrier>& BarriersAfter(uint32_t pass) const { return passes[pass].after; }
+
+	private:
+		struct Attachment
+		{
+			GraphResource image;
+			bool depth, clear;
+			VkClearValue clearValue;
+		};
+		struct Read
+		{
+			GraphResource image;
+			VkPipelineStageFlags stages;
+		};
+		struct Pass
+		{
+			std::string name;
+			std::vector<Attachment> attachments;
+			std::vector<Read> reads;
+
+			//derived by Compile
+			bool culled = false;
+			VkRenderPass renderPass = 0;
+			std::vector<VkClearValue> clearValues;
+			std::vector<Barrier> before, after;
+		};
+		//an image's last use, what the next one has to wait for
+		struct Usage
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags stage = 0;
+			VkAccessFlags access = 0;
+			bool written = false; //holds contents a later pass can load
+		};
+		struct Resource
+		{
+			std::string name;
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent = {0, 0};
+			bool imported = false, output = false;
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			Usage initial;
+			std::vector<VkImage> importedImages;
+			std::vector<VkImageView> importedViews;
+
+			//derived by Compile
+			uint32_t firstPass = 0xFFFFFFFF, lastPass = 0;
+			VkImageUsageFlags usage = 0;
+			bool stored = false; //by any pass, otherwise it never leaves a render pass
+		};
+
+		uint32_t NextUse(GraphResource image, uint32_t pass, VkImageLayout &layout) const;
+		void CmdBarriers(VkCommandBuffer cmd, const std::vector<Barrier> &barriers, uint32_t instance) const;
+		VkImage Image(GraphResource image, uint32_t instance) const;
+		VkExtent2D Extent(GraphResource image) const;
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		//owned images sharing memory, by first pass. each one's lifetime ends before the next one's starts
+		std::vector<std::vector<GraphResource>> aliasSlots;
+		Targets targets;
+		VkDeviceSize transientSize = 0, transientMemory = 0;
+
+		VkDevice device = 0;
+		DeviceAllocator* allocator = 0;
+};
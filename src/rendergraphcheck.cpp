@@ -0,0 +1,175 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "allocator.hpp"
+#include "rendergraph.hpp"
+
+
+//what ctest reports as skipped, for machines without a vulkan device
+static const int skipped = 77;
+
+
+//the first device with a graphics queue, the check only creates render passes and images on it
+static bool CreateDevice(VkInstance &instance, VkPhysicalDevice &physicalDevice, VkDevice &device)
+{
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "rendergraphcheck";
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instanceInfo = {};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+	if(vkCreateInstance(&instanceInfo, 0, &instance) != VK_SUCCESS)
+	{
+		std::cout << "vkCreateInstance failed\n";
+		return false;
+	}
+
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, 0);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+	for(const auto &v : devices)
+	{
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(v, &familyCount, 0);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(v, &familyCount, families.data());
+
+		const auto graphics = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties &f)
+		{
+			return f.queueCount && (f.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+		});
+		if(graphics == families.end())
+		{
+			continue;
+		}
+
+		const float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo = {};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = graphics - families.begin();
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+
+		VkDeviceCreateInfo deviceInfo = {};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+		if(vkCreateDevice(v, &deviceInfo, 0, &device) == VK_SUCCESS)
+		{
+			physicalDevice = v;
+			return true;
+		}
+	}
+
+	std::cout << "No device with a graphics queue found\n";
+	return false;
+}
+
+
+//compiles a graph going through culling, aliasing, transient images and sampling barriers and checks
+//what came out: an offscreen scene with a depth buffer, a pass nothing reads, a half size pass in
+//between, and a post pass sampling them along with an imported image
+static bool Check(VkDevice device, DeviceAllocator &allocator)
+{
+	RenderGraph graph;
+	graph.Create(device, allocator);
+	const GraphResource hdr = graph.CreateImage("hdr", VK_FORMAT_R16G16B16A16_SFLOAT);
+	const GraphResource depth = graph.CreateImage("depth", VK_FORMAT_D16_UNORM);
+	const GraphResource overlay = graph.CreateImage("overlay", VK_FORMAT_R8G8B8A8_UNORM);
+	const GraphResource bloom = graph.CreateImage("bloom", VK_FORMAT_R16G16B16A16_SFLOAT, {128, 128});
+	const GraphResource result = graph.CreateImage("result", VK_FORMAT_R8G8B8A8_UNORM);
+	const GraphResource history = graph.ImportImage("history", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+													VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	graph.MarkOutput(result);
+
+	const VkClearColorValue clearColor = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	const VkClearDepthStencilValue clearDepth = {1.0f, 0};
+	const uint32_t scene = graph.AddPass("scene");
+	graph.WriteColor(scene, hdr, &clearColor);
+	graph.WriteDepth(scene, depth, &clearDepth);
+	const uint32_t debug = graph.AddPass("debug");
+	graph.WriteColor(debug, overlay, &clearColor);
+	const uint32_t blur = graph.AddPass("bloom");
+	graph.Sample(blur, hdr);
+	graph.WriteColor(blur, bloom, &clearColor);
+	const uint32_t post = graph.AddPass("post");
+	graph.Sample(post, hdr);
+	graph.Sample(post, bloom);
+	graph.Sample(post, history);
+	graph.WriteColor(post, result);
+
+	//nothing is recorded, the imported image only has to have something to count instances by
+	graph.SetImportedImages(history, {VK_NULL_HANDLE}, {VK_NULL_HANDLE});
+	bool ok = graph.Compile() && graph.CreateTargets({256, 256});
+	if(!ok)
+	{
+		std::cout << "Render graph check failed: the graph didn't compile or its targets couldn't be created\n";
+	}
+
+	const auto Expect = [&](bool condition, const char* what)
+	{
+		if(ok && !condition)
+		{
+			std::cout << "Render graph check failed: " << what << "\n";
+			ok = false;
+		}
+	};
+	const auto Moves = [&](const std::vector<RenderGraph::Barrier> &barriers, VkImageLayout from, VkImageLayout to)
+	{
+		return std::any_of(barriers.begin(), barriers.end(), [&](const RenderGraph::Barrier &b)
+		{
+			return b.image == history && b.oldLayout == from && b.newLayout == to;
+		});
+	};
+	Expect(graph.Culled(debug) && !graph.RenderPass(debug) && !graph.ImageUsage(overlay), "the unread pass wasn't culled");
+	Expect(!graph.Culled(scene) && !graph.Culled(blur) && !graph.Culled(post), "a needed pass was culled");
+	Expect(graph.ImageUsage(depth) == (VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT), "depth isn't a transient attachment");
+	Expect(graph.ImageUsage(hdr) == (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT), "hdr isn't a sampled attachment");
+	Expect(!(graph.ImageUsage(result) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT), "the output is transient");
+	Expect(graph.AliasSlotCount() == 3 && graph.Aliased(depth, bloom) && !graph.Aliased(hdr, bloom), "depth and bloom don't share a slot");
+	Expect(graph.BarriersBefore(post).size() == 1
+		   && Moves(graph.BarriersBefore(post), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+		   "the imported image isn't made readable before post");
+	Expect(graph.BarriersAfter(post).size() == 1
+		   && Moves(graph.BarriersAfter(post), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL),
+		   "the imported image isn't returned to its final layout");
+	Expect(graph.BarriersBefore(blur).empty() && graph.BarriersBefore(scene).empty(), "rendered images are sampled through barriers instead of render passes");
+
+	graph.Destroy();
+	return ok;
+}
+
+
+int main()
+{
+	VkInstance instance = 0;
+	VkPhysicalDevice physicalDevice = 0;
+	VkDevice device = 0;
+	if(!CreateDevice(instance, physicalDevice, device))
+	{
+		if(instance)
+		{
+			vkDestroyInstance(instance, 0);
+		}
+		return skipped;
+	}
+
+	DeviceAllocator allocator;
+	allocator.Create(device, physicalDevice, 1);
+	const bool ok = Check(device, allocator);
+	allocator.Destroy();
+
+	vkDestroyDevice(device, 0);
+	vkDestroyInstance(instance, 0);
+
+	std::cout << "Render graph check " << (ok ? "passed" : "failed") << "\n";
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "scene.hpp"
+
+
+//every combination of passing lanes, packed to the front. the kernels add the block's first index
+//and store all lanes, only the passing ones count, the rest is overwritten by the next store
+template<uint32_t Width>
+struct LaneTable
+{
+	alignas(32) uint32_t lanes[1 << Width][Width];
+	uint8_t counts[1 << Width];
+
+	LaneTable()
+	{
+		for(uint32_t mask = 0; mask < (1 << Width); ++mask)
+		{
+			uint32_t count = 0;
+			for(uint32_t x = 0; x < Width; ++x)
+			{
+				lanes[mask][x] = 0;
+				if(mask & (1 << x))
+				{
+					lanes[mask][count++] = x;
+				}
+			}
+			counts[mask] = count;
+		}
+	}
+};
+
+
+Frustum Frustum::FromMatrix(const float matrix[16])
+{
+	//each plane is a sum of the matrix's rows (Gribb and Hartmann), clip space z runs from 0 to w
+	const auto Row = [&](uint32_t row, float* out)
+	{
+		for(uint32_t x = 0; x < 4; ++x)
+		{
+			out[x] = matrix[x * 4 + row];
+		}
+	};
+	float rows[4][4];
+	for(uint32_t x = 0; x < 4; ++x)
+	{
+		Row(x, rows[x]);
+	}
+
+	Frustum frustum;
+	for(uint32_t x = 0; x < 6; ++x)
+	{
+		float plane[4];
+		for(uint32_t y = 0; y < 4; ++y)
+		{
+			switch(x)
+			{
+				case 0: plane[y] = rows[3][y] + rows[0][y]; break;
+				case 1: plane[y] = rows[3][y] - rows[0][y]; break;
+				case 2: plane[y] = rows[3][y] + rows[1][y]; break;
+				case 3: plane[y] = rows[3][y] - rows[1][y]; break;
+				case 4: plane[y] = rows[2][y]; break;
+				default: plane[y] = rows[3][y] - rows[2][y]; break;
+			}
+		}
+
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		frustum.planes[x] = {{plane[0] * scale, plane[1] * scale, plane[2] * scale}, plane[3] * scale};
+	}
+	return frustum;
+}
+
+
+const char* CullKernelName(CullKernel kernel)
+{
+	switch(kernel)
+	{
+		case CullKernel::Avx2: return "avx2";
+		case CullKernel::Sse: return "sse";
+		default: return "scalar";
+	}
+}
+
+
+CullKernel BestCullKernel()
+{
+#if defined(__AVX2__)
+	return CullKernel::Avx2;
+#elif defined(__SSE2__)
+	return CullKernel::Sse;
+#else
+	return CullKernel::Scalar;
+#endif
+}
+
+
+uint32_t Scene::Add(const float position[3], const float rotation[4], float scale, float radius)
+{
+	const uint32_t index = count++;
+	Pad();
+	localRadius[index] = radius;
+	SetTransform(index, position, rotation, scale);
+	return index;
+}
+
+
+void Scene::SetTransform(uint32_t index, const float position[3], const float rotation[4], float scale)
+{
+	positionX[index] = position[0];
+	positionY[index] = position[1];
+	positionZ[index] = position[2];
+	for(uint32_t x = 0; x < 4; ++x)
+	{
+		this->rotation[x][index] = rotation[x];
+	}
+	this->scale[index] = scale;
+	radius[index] = localRadius[index] * std::fabs(scale);
+}
+
+
+void Scene::Clear()
+{
+	count = 0;
+	Pad();
+}
+
+
+void Scene::Reserve(uint32_t count)
+{
+	const size_t size = (size_t(count) + 7) & ~size_t(7);
+	for(AlignedFloats* v : {&positionX, &positionY, &positionZ, &rotation[0], &rotation[1], &rotation[2], &rotation[3], &scale, &localRadius, &radius})
+	{
+		v->reserve(size);
+	}
+}
+
+
+void Scene::Cull(const Frustum &frustum, std::vector<uint32_t> &visible, CullKernel kernel) const
+{
+	switch(kernel)
+	{
+		case CullKernel::Avx2:
+			CullAvx2(frustum, visible);
+			break;
+		case CullKernel::Sse:
+			CullSse(frustum, visible);
+			break;
+		default:
+			CullScalar(frustum, visible);
+			break;
+	}
+}
+
+
+void Scene::CullScalar(const Frustum &frustum, std::vector<uint32_t> &visible) const
+{
+	//same operation order as the simd kernels, so every kernel agrees on spheres touching a plane
+	visible.clear();
+	for(uint32_t x = 0; x < count; ++x)
+	{
+		bool inside = true;
+		for(const auto &v : frustum.planes)
+		{
+			const float distance = v.normal[0] * positionX[x] + v.normal[1] * positionY[x] + v.normal[2] * positionZ[x] + v.d;
+			if(!(distance > -radius[x]))
+			{
+				inside = false;
+				break;
+			}
+		}
+		if(inside)
+		{
+			visible.push_back(x);
+		}
+	}
+}
+
+
+void Scene::CullSse(const Frustum &frustum, std::vector<uint32_t> &visible) const
+{
+#ifdef __SSE2__
+	static const LaneTable<4> table;
+
+	__m128 nx[6], ny[6], nz[6], d[6];
+	for(uint32_t x = 0; x < 6; ++x)
+	{
+		nx[x] = _mm_set1_ps(frustum.planes[x].normal[0]);
+		ny[x] = _mm_set1_ps(frustum.planes[x].normal[1]);
+		nz[x] = _mm_set1_ps(frustum.planes[x].normal[2]);
+		d[x] = _mm_set1_ps(frustum.planes[x].d);
+	}
+
+	//the padding never passes, so a store can't run past the padded size
+	visible.resize(positionX.size());
+	uint32_t* out = visible.data();
+	uint32_t written = 0;
+
+	for(uint32_t x = 0; x < positionX.size(); x += 4)
+	{
+		const __m128 px = _mm_load_ps(&positionX[x]);
+		const __m128 py = _mm_load_ps(&positionY[x]);
+		const __m128 pz = _mm_load_ps(&positionZ[x]);
+		const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(&radius[x]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for(uint32_t y = 0; y < 6; ++y)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[y], px), _mm_mul_ps(ny[y], py)), _mm_mul_ps(nz[y], pz)), d[y]);
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+		}
+
+		const int mask = _mm_movemask_ps(inside);
+		const __m128i lanes = _mm_load_si128(reinterpret_cast<const __m128i*>(table.lanes[mask]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), _mm_add_epi32(lanes, _mm_set1_epi32(x)));
+		written += table.counts[mask];
+	}
+	visible.resize(written);
+#else
+	CullScalar(frustum, visible);
+#endif
+}
+
+
+void Scene::CullAvx2(const Frustum &frustum, std::vector<uint32_t> &visible) const
+{
+#ifdef __AVX2__
+	static const LaneTable<8> table;
+
+	__m256 nx[6], ny[6], nz[6], d[6];
+	for(uint32_t x = 0; x < 6; ++x)
+	{
+		nx[x] = _mm256_set1_ps(frustum.planes[x].normal[0]);
+		ny[x] = _mm256_set1_ps(frustum.planes[x].normal[1]);
+		nz[x] = _mm256_set1_ps(frustum.planes[x].normal[2]);
+		d[x] = _mm256_set1_ps(frustum.planes[x].d);
+	}
+
+	visible.resize(positionX.size());
+	uint32_t* out = visible.data();
+	uint32_t written = 0;
+
+	for(uint32_t x = 0; x < positionX.size(); x += 8)
+	{
+		const __m256 px = _mm256_load_ps(&positionX[x]);
+		const __m256 py = _mm256_load_ps(&positionY[x]);
+		const __m256 pz = _mm256_load_ps(&positionZ[x]);
+		const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_load_ps(&radius[x]));
+
+		//separate multiplies and adds, built without contraction so they round like the scalar kernel
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for(uint32_t y = 0; y < 6; ++y)
+		{
+			const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[y], px), _mm256_mul_ps(ny[y], py)), _mm256_mul_ps(nz[y], pz)), d[y]);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+		}
+
+		const int mask = _mm256_movemask_ps(inside);
+		const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.lanes[mask]));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + written), _mm256_add_epi32(lanes, _mm256_set1_epi32(x)));
+		written += table.counts[mask];
+	}
+	visible.resize(written);
+#else
+	CullSse(frustum, visible);
+#endif
+}
+
+
+void Scene::Pad()
+{
+	//whole blocks of 8, the padding sits at the origin with a radius no distance can beat
+	const size_t size = (size_t(count) + 7) & ~size_t(7);
+	for(AlignedFloats* v : {&positionX, &positionY, &positionZ, &rotation[0], &rotation[1], &rotation[2], &rotation[3], &scale, &localRadius, &radius})
+	{
+		v->resize(size, 0.0f);
+	}
+	std::fill(radius.begin() + count, radius.end(), -FLT_MAX);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "aligned.hpp"
+
+
+typedef AlignedVector<float, 32> AlignedFloats;
+
+
+//points inside have normal . p + d >= 0, normals are unit length so the distance is in world units
+struct Plane
+{
+	float normal[3];
+	float d;
+};
+
+struct Frustum
+{
+	Plane planes[6]; //left, right, bottom, top, near, far
+
+	//from a column major view projection matrix with vulkan's [0, 1] depth range
+	static Frustum FromMatrix(const float matrix[16]);
+};
+
+//which culling kernel was compiled in, picked by the target's instruction set (-march=native)
+enum class CullKernel
+{
+	Scalar,
+	Sse, //4 spheres per iteration
+	Avx2, //8 spheres per iteration
+};
+
+const char* CullKernelName(CullKernel kernel);
+CullKernel BestCullKernel();
+
+//objects as structure of arrays, so culling streams through one array per component and
+//loads 8 objects' worth of each at once. the bounding sphere is kept in world space next to
+//the transform it's derived from. arrays are padded to a multiple of 8 with spheres that
+//fail every plane, so kernels never need a remainder loop.
+//only cullbench drives it for now, the renderer records its whole draw list and culls on the gpu
+class Scene
+{
+	public:
+		//rotation is a unit quaternion (x, y, z, w), radius bounds the object at scale 1 around its position
+		uint32_t Add(const float position[3], const float rotation[4], float scale, float radius);
+		void SetTransform(uint32_t index, const float position[3], const float rotation[4], float scale);
+		void Clear();
+		void Reserve(uint32_t count);
+		uint32_t Size() const { return count; }
+
+		//indices of the objects touching the frustum, in increasing order
+		void Cull(const Frustum &frustum, std::vector<uint32_t> &visible, CullKernel kernel = BestCullKernel()) const;
+
+		const float* PositionX() const { return positionX.data(); }
+		const float* PositionY() const { return positionY.data(); }
+		const float* PositionZ() const { return positionZ.data(); }
+		const float* Rotation(uint32_t component) const { return rotation[component].data(); }
+		const float* Scale() const { return scale.data(); }
+		const float* Radius() const { return radius.data(); }
+
+	private:
+		void CullScalar(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+		void CullSse(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+		void CullAvx2(const Frustum &frustum, std::vector<uint32_t> &visible) const;
+		void Pad();
+
+		uint32_t count = 0;
+		AlignedFloats positionX, positionY, positionZ; //also the bounding spheres' centres
+		AlignedFloats rotation[4];
+		AlignedFloats scale;
+		AlignedFloats localRadius, radius; //radius is localRadius * scale
+};
@@ -0,0 +1,18 @@
+#include "shaders.hpp"
+
+//generated by cmake: one array per shader in src/shaders plus the embeddedShaders table
+#include "embedded_shaders.inc"
+
+
+ShaderCode GetEmbeddedShader(const std::string &name)
+{
+	for(const auto &v : embeddedShaders)
+	{
+		if(name == v.name)
+		{
+			return {v.code, v.size};
+		}
+	}
+
+	return {0, 0};
+}
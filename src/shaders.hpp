@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+struct ShaderCode
+{
+	const uint32_t* code;
+	size_t size; //in bytes
+};
+
+//spir-v compiled into the binary at build time, keyed by source file name ("shader.vert").
+//code is null if there is no such shader
+ShaderCode GetEmbeddedShader(const std::string &name);
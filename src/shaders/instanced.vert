@@ -0,0 +1,43 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+//per instance, unpacked by the vertex fetch from snorm16 / half / unorm8
+layout(location = 2) in vec2 instancePosition;
+layout(location = 3) in vec2 instanceScaleRotation;
+layout(location = 4) in vec4 instanceColor;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV; //the triangle's own [-0.5, 0.5] square mapped to [0, 1]
+
+//per frame, set through a dynamic offset into the uniform ring
+layout(set = 0, binding = 0) uniform Frame
+{
+	vec2 viewScale;
+	vec2 viewOffset;
+	float time;
+} frame;
+
+//per draw, the texture index is only read by the fragment shader
+layout(push_constant) uniform Draw
+{
+	vec4 tint;
+} draw;
+
+void main()
+{
+	float s = sin(instanceScaleRotation.y);
+	float c = cos(instanceScaleRotation.y);
+	vec2 position = mat2(c, s, -s, c) * inPosition * instanceScaleRotation.x + instancePosition;
+
+	gl_Position = vec4(position * frame.viewScale + frame.viewOffset, 0.0, 1.0);
+	fragColor = inColor * instanceColor.rgb * draw.tint.rgb;
+	fragUV = inPosition + 0.5;
+}
@@ -0,0 +1,31 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+	float gl_PointSize;
+};
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inVelocity;
+
+layout(location = 0) out vec3 fragColor;
+
+//per frame, set through a dynamic offset into the uniform ring
+layout(set = 0, binding = 0) uniform Frame
+{
+	vec2 viewScale;
+	vec2 viewOffset;
+	float time;
+} frame;
+
+//speed at which a particle is drawn fully hot
+layout(constant_id = 0) const float hotSpeed = 1.0;
+
+void main()
+{
+	gl_Position = vec4(inPosition * frame.viewScale + frame.viewOffset, 0.0, 1.0);
+	gl_PointSize = 1.0;
+	fragColor = mix(vec3(0.2, 0.4, 1.0), vec3(1.0, 0.5, 0.1), clamp(length(inVelocity) / hotSpeed, 0.0, 1.0));
+}
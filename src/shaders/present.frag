@@ -0,0 +1,12 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) out vec4 outColor;
+
+//the scene pass's colour target, the same size as the one written here
+layout(set = 0, binding = 0) uniform sampler2D scene;
+
+void main()
+{
+	outColor = texelFetch(scene, ivec2(gl_FragCoord.xy), 0);
+}
@@ -6,24 +6,29 @@ out gl_PerVertex
 	vec4 gl_Position;
 };
 
-vec2 positions[3] = vec2[]
-(
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
-
-vec3 colors[3] = vec3[]
-(
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV; //the triangle's own [-0.5, 0.5] square mapped to [0, 1]
+
+//per frame, set through a dynamic offset into the uniform ring
+layout(set = 0, binding = 0) uniform Frame
+{
+	vec2 viewScale;
+	vec2 viewOffset;
+	float time;
+} frame;
+
+//per draw, the texture index is only read by the fragment shader
+layout(push_constant) uniform Draw
+{
+	vec4 tint;
+} draw;
 
 void main()
 {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = vec4(inPosition * frame.viewScale + frame.viewOffset, 0.0, 1.0);
+	fragColor = inColor * draw.tint.rgb;
+	fragUV = inPosition + 0.5;
 }
@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+//image elements of the resource table, its capacity differs with and without descriptor indexing
+layout(constant_id = 0) const uint textureCapacity = 1;
+layout(set = 1, binding = 0) uniform sampler2D textures[textureCapacity];
+
+//per draw, the index is uniform across the draw so plain dynamic indexing is enough
+layout(push_constant) uniform Draw
+{
+	vec4 tint;
+	uint textureIndex;
+} draw;
+
+void main()
+{
+	vec3 color = fragColor;
+	if(draw.textureIndex < textureCapacity)
+	{
+		color *= texture(textures[draw.textureIndex], fragUV).rgb;
+	}
+	outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,727 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+
+#include "textures.hpp"
+#include "file.hpp"
+
+
+//whitespace and comments up to the next number, then the number
+static bool ReadPpmNumber(const uint8_t* data, size_t size, size_t &pos, uint32_t &value)
+{
+	while(pos < size && (std::isspace(data[pos]) || data[pos] == '#'))
+	{
+		if(data[pos] == '#')
+		{
+			while(pos < size && data[pos] != '\n')
+			{
+				++pos;
+			}
+		}
+		else
+		{
+			++pos;
+		}
+	}
+	if(pos >= size || !std::isdigit(data[pos]))
+	{
+		return false;
+	}
+
+	value = 0;
+	while(pos < size && std::isdigit(data[pos]) && value < (1u << 24))
+	{
+		value = value * 10 + (data[pos] - '0');
+		++pos;
+	}
+	return true;
+}
+
+
+static bool DecodePpm(const uint8_t* data, size_t size, DecodedImage &image, uint32_t maxDimension)
+{
+	size_t pos = 2;
+	uint32_t width, height, maxValue;
+	if(!ReadPpmNumber(data, size, pos, width) || !ReadPpmNumber(data, size, pos, height) || !ReadPpmNumber(data, size, pos, maxValue)
+	   || !width || !height || !maxValue || maxValue > 65535)
+	{
+		image.error = "bad ppm header";
+		return false;
+	}
+	if(std::max(width, height) > maxDimension)
+	{
+		image.error = "larger than the device's image limit";
+		return false;
+	}
+	++pos; //one whitespace character ends the header
+
+	//samples above 255 are two bytes, most significant first
+	const size_t sampleSize = maxValue > 255 ? 2 : 1;
+	const size_t count = size_t(width) * height;
+	if(pos > size || (size - pos) / (3 * sampleSize) < count)
+	{
+		image.error = "truncated ppm";
+		return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(count * 4);
+	const uint8_t* src = data + pos;
+	for(size_t x = 0; x < count; ++x)
+	{
+		for(size_t c = 0; c < 3; ++c, src += sampleSize)
+		{
+			const uint32_t value = sampleSize == 2 ? src[0] << 8 | src[1] : src[0];
+			image.pixels[x * 4 + c] = uint8_t(value * 255 / maxValue);
+		}
+		image.pixels[x * 4 + 3] = 255;
+	}
+	return true;
+}
+
+
+static bool DecodeTga(const uint8_t* data, size_t size, DecodedImage &image, uint32_t maxDimension)
+{
+	if(size < 18)
+	{
+		image.error = "truncated tga";
+		return false;
+	}
+
+	const uint32_t idLength = data[0], colorMapType = data[1], imageType = data[2];
+	const uint32_t width = data[12] | data[13] << 8, height = data[14] | data[15] << 8;
+	const uint32_t pixelSize = data[16] / 8;
+	const bool topDown = data[17] & 0x20;
+	if(colorMapType != 0 || (imageType != 2 && imageType != 10) || (pixelSize != 3 && pixelSize != 4) || !width || !height)
+	{
+		image.error = "unsupported tga, only 24 or 32 bit truecolour is read";
+		return false;
+	}
+	if(std::max(width, height) > maxDimension)
+	{
+		image.error = "larger than the device's image limit";
+		return false;
+	}
+
+	//type 10 is run length encoded: a header byte, then one pixel repeated or a run of raw pixels.
+	//a packet covers at most 128 pixels, so a header promising more than the data can hold is
+	//rejected before the pixels are allocated
+	const size_t count = size_t(width) * height;
+	size_t pos = 18 + idLength;
+	const size_t dataSize = pos < size ? size - pos : 0;
+	const size_t maxCount = imageType == 10 ? dataSize / (1 + pixelSize) * 128 : dataSize / pixelSize;
+	if(count > maxCount)
+	{
+		image.error = "truncated tga";
+		return false;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(count * 4);
+	size_t x = 0;
+	while(x < count)
+	{
+		size_t run = count - x;
+		bool repeat = false;
+		if(imageType == 10)
+		{
+			if(pos >= size)
+			{
+				break;
+			}
+			run = std::min<size_t>((data[pos] & 0x7F) + 1, count - x);
+			repeat = data[pos] & 0x80;
+			++pos;
+		}
+
+		for(size_t y = 0; y < run; ++y, ++x)
+		{
+			if(pos + pixelSize > size)
+			{
+				image.error = "truncated tga";
+				return false;
+			}
+
+			//bgr(a), bottom row first unless the descriptor says otherwise
+			const size_t row = x / width, column = x % width;
+			uint8_t* dst = &image.pixels[((topDown ? row : height - 1 - row) * width + column) * 4];
+			dst[0] = data[pos + 2];
+			dst[1] = data[pos + 1];
+			dst[2] = data[pos];
+			dst[3] = pixelSize == 4 ? data[pos + 3] : 255;
+			if(!repeat || y + 1 == run)
+			{
+				pos += pixelSize;
+			}
+		}
+	}
+
+	if(x < count)
+	{
+		image.error = "truncated tga";
+		return false;
+	}
+	return true;
+}
+
+
+bool DecodeImage(const uint8_t* data, size_t size, DecodedImage &image, uint32_t maxDimension)
+{
+	//tga has no signature, anything that isn't a ppm is tried as one
+	if(size >= 2 && data[0] == 'P' && data[1] == '6')
+	{
+		return DecodePpm(data, size, image, maxDimension);
+	}
+	return DecodeTga(data, size, image, maxDimension);
+}
+
+
+//the first level whose larger side fits previewSize, every texel the average of the block it covers
+static void BuildPreview(DecodedImage &image, uint32_t previewSize)
+{
+	uint32_t level = 0;
+	while(std::max(image.width, image.height) >> level > previewSize)
+	{
+		++level;
+	}
+	image.previewLevel = level;
+	image.previewWidth = std::max(image.width >> level, 1u);
+	image.previewHeight = std::max(image.height >> level, 1u);
+	if(!level)
+	{
+		image.preview = image.pixels;
+		return;
+	}
+
+	image.preview.resize(image.previewWidth * image.previewHeight * 4);
+	const uint32_t block = 1u << level;
+	for(uint32_t py = 0; py < image.previewHeight; ++py)
+	{
+		const uint32_t y0 = py * block, y1 = std::min(y0 + block, image.height);
+		for(uint32_t px = 0; px < image.previewWidth; ++px)
+		{
+			const uint32_t x0 = px * block, x1 = std::min(x0 + block, image.width);
+
+			uint32_t sum[4] = {};
+			for(uint32_t y = y0; y < y1; ++y)
+			{
+				const uint8_t* src = &image.pixels[(size_t(y) * image.width + x0) * 4];
+				for(uint32_t x = x0; x < x1; ++x, src += 4)
+				{
+					sum[0] += src[0];
+					sum[1] += src[1];
+					sum[2] += src[2];
+					sum[3] += src[3];
+				}
+			}
+
+			const uint32_t count = (x1 - x0) * (y1 - y0);
+			uint8_t* dst = &image.preview[(py * image.previewWidth + px) * 4];
+			for(uint32_t c = 0; c < 4; ++c)
+			{
+				dst[c] = uint8_t((sum[c] + count / 2) / count);
+			}
+		}
+	}
+}
+
+
+static void ImageBarrier(VkCommandBuffer cmd, VkImage image, uint32_t firstMip, uint32_t mipCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+						 VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, firstMip, mipCount, 0, 1};
+	vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, 0, 0, 0, 1, &barrier);
+}
+
+
+//src in TRANSFER_SRC_OPTIMAL, dst in TRANSFER_DST_OPTIMAL. works in either direction
+static void BlitLevel(VkCommandBuffer cmd, VkImage image, uint32_t width, uint32_t height, uint32_t src, uint32_t dst)
+{
+	VkImageBlit blit = {};
+	blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, src, 0, 1};
+	blit.srcOffsets[1] = {int32_t(std::max(width >> src, 1u)), int32_t(std::max(height >> src, 1u)), 1};
+	blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, dst, 0, 1};
+	blit.dstOffsets[1] = {int32_t(std::max(width >> dst, 1u)), int32_t(std::max(height >> dst, 1u)), 1};
+	vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+}
+
+
+static VkImageView CreateView(VkDevice device, VkImage image, uint32_t mipLevels)
+{
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+
+	VkImageView view = VK_NULL_HANDLE;
+	vkCreateImageView(device, &viewInfo, 0, &view);
+	return view;
+}
+
+
+void TextureStreamer::Create(VkDevice device, VkPhysicalDevice physicalDevice, DeviceAllocator &allocator, DescriptorTable &table,
+							 uint32_t queueFamily, uint32_t frameCount, VkDeviceSize frameBudget, uint32_t threadCount)
+{
+	this->device = device;
+	this->allocator = &allocator;
+	this->table = &table;
+	this->frameBudget = frameBudget;
+	frameCount = std::max(frameCount, 1u);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	maxDimension = properties.limits.maxImageDimension2D;
+
+	//a row of the widest image always fits, or it could never be uploaded
+	staging.Create(allocator, physicalDevice, frameCount, std::max<VkDeviceSize>(frameBudget, VkDeviceSize(maxDimension) * 4),
+				   VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	loaders.Create(threadCount);
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	pools.resize(frameCount);
+	commandBuffers.resize(frameCount);
+	for(uint32_t x = 0; x < frameCount; ++x)
+	{
+		vkCreateCommandPool(device, &poolInfo, 0, &pools[x]);
+		allocInfo.commandPool = pools[x];
+		vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[x]);
+	}
+
+	//r8g8b8a8 unorm has to support blits and linear filtering with optimal tiling, nothing to check
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	vkCreateSampler(device, &samplerInfo, 0, &sampler);
+
+	//1x1 white, cleared by the first Update before any frame samples it
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = {1, 1, 1};
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if(allocator.CreateImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholder, placeholderAllocation))
+	{
+		placeholderView = CreateView(device, placeholder, 1);
+		placeholderIndex = table.AddImage(placeholderView, sampler);
+	}
+}
+
+
+void TextureStreamer::Destroy()
+{
+	//queued decodes still run, their results are dropped
+	loaders.Destroy();
+	if(!device)
+	{
+		return;
+	}
+
+	for(auto &v : textures)
+	{
+		if(v.tableIndex != 0xFFFFFFFF)
+		{
+			table->RemoveImage(v.tableIndex);
+		}
+		if(v.view)
+		{
+			vkDestroyImageView(device, v.view, 0);
+		}
+		allocator->DestroyImage(v.image, v.allocation);
+	}
+	textures.clear();
+
+	if(placeholderIndex != 0xFFFFFFFF)
+	{
+		table->RemoveImage(placeholderIndex);
+	}
+	if(placeholderView)
+	{
+		vkDestroyImageView(device, placeholderView, 0);
+	}
+	allocator->DestroyImage(placeholder, placeholderAllocation);
+
+	for(auto &v : pools)
+	{
+		vkDestroyCommandPool(device, v, 0);
+	}
+	pools.clear();
+	commandBuffers.clear();
+	staging.Destroy(*allocator);
+	vkDestroySampler(device, sampler, 0);
+	device = 0;
+}
+
+
+TextureHandle TextureStreamer::Load(const std::string &path)
+{
+	Texture texture;
+	texture.path = path;
+
+	const uint32_t previewSize = std::max(this->previewSize, 1u);
+	const uint32_t maxDimension = this->maxDimension;
+	texture.decode = loaders.Submit([path, previewSize, maxDimension]()
+	{
+		DecodedImage image;
+		MappedFile file;
+		const FileError error = file.Open(path);
+		if(error != FileError::None)
+		{
+			image.error = FileErrorString(error);
+			return image;
+		}
+
+		//a failed allocation fails the texture, not the thread that collects the result
+		try
+		{
+			file.AdviseSequential();
+			if(DecodeImage(file.Data(), file.Size(), image, maxDimension))
+			{
+				BuildPreview(image, previewSize);
+			}
+		}
+		catch(const std::exception &e)
+		{
+			image = DecodedImage();
+			image.error = e.what();
+		}
+		return image;
+	});
+
+	textures.push_back(std::move(texture));
+	return textures.size() - 1;
+}
+
+
+VkCommandBuffer TextureStreamer::Update(uint32_t frame)
+{
+	if(!device)
+	{
+		return VK_NULL_HANDLE;
+	}
+	staging.BeginSlot(frame);
+
+	//the previews uploaded the last time this frame ran are done, their views get indices of their own.
+	//nothing in flight uses a fresh index, so it's written even into an update after bind set that's bound.
+	//a full table leaves the texture on the placeholder
+	for(auto &v : textures)
+	{
+		if(v.viewFrame == frame)
+		{
+			v.tableIndex = table->AddImage(v.view, sampler);
+			v.viewFrame = 0xFFFFFFFF;
+		}
+	}
+
+	if(!placeholderCleared && placeholder)
+	{
+		const VkCommandBuffer cmd = BeginCommands(frame);
+		ImageBarrier(cmd, placeholder, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		const VkClearColorValue white = {{1.0f, 1.0f, 1.0f, 1.0f}};
+		const VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+		vkCmdClearColorImage(cmd, placeholder, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &range);
+		ImageBarrier(cmd, placeholder, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		placeholderCleared = true;
+	}
+
+	//in load order, so the first textures asked for finish first
+	VkDeviceSize budget = frameBudget;
+	for(auto &v : textures)
+	{
+		if(v.state == TextureState::Loading && !v.image)
+		{
+			if(v.decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				continue;
+			}
+
+			v.decoded = v.decode.get();
+			if(!v.decoded.error.empty() || !CreateImage(v))
+			{
+				std::cout << "Texture " << v.path << " failed to load: " << v.decoded.error << ", drawing the placeholder\n";
+				v.decoded = DecodedImage();
+				v.state = TextureState::Failed;
+				continue;
+			}
+		}
+
+		//previews are tiny and make the texture drawable, they go ahead of the budget
+		if(v.state == TextureState::Loading)
+		{
+			const VkDeviceSize previewBytes = v.decoded.preview.size();
+			if(!UploadPreview(frame, v))
+			{
+				continue;
+			}
+			budget -= std::min(budget, previewBytes);
+		}
+
+		if(v.state == TextureState::Preview)
+		{
+			//a row wider than the whole budget still goes through, alone
+			const VkDeviceSize rowSize = VkDeviceSize(v.width) * 4;
+			uint32_t rows = std::min<VkDeviceSize>(budget / rowSize, v.height - v.rowsUploaded);
+			if(!rows && budget == frameBudget)
+			{
+				rows = 1;
+			}
+			if(rows && UploadRows(frame, v, rows))
+			{
+				budget -= std::min(budget, rows * rowSize);
+			}
+		}
+	}
+
+	if(!recording)
+	{
+		return VK_NULL_HANDLE;
+	}
+	vkEndCommandBuffer(commandBuffers[frame]);
+	recording = false;
+	return commandBuffers[frame];
+}
+
+
+uint32_t TextureStreamer::TableIndex(TextureHandle handle) const
+{
+	if(handle >= textures.size())
+	{
+		return 0xFFFFFFFF;
+	}
+	const uint32_t index = textures[handle].tableIndex;
+	return index != 0xFFFFFFFF ? index : placeholderIndex;
+}
+
+
+TextureState TextureStreamer::State(TextureHandle handle) const
+{
+	return handle < textures.size() ? textures[handle].state : TextureState::Failed;
+}
+
+
+uint32_t TextureStreamer::ResidentMip(TextureHandle handle) const
+{
+	if(handle >= textures.size())
+	{
+		return 0xFFFFFFFF;
+	}
+
+	const Texture &texture = textures[handle];
+	switch(texture.state)
+	{
+		case TextureState::Preview: return texture.decoded.previewLevel;
+		case TextureState::Resident: return 0;
+		default: return texture.mipLevels;
+	}
+}
+
+
+bool TextureStreamer::CreateImage(Texture &texture)
+{
+	texture.width = texture.decoded.width;
+	texture.height = texture.decoded.height;
+	if(std::max(texture.width, texture.height) > maxDimension)
+	{
+		texture.decoded.error = "larger than the device's image limit";
+		return false;
+	}
+
+	//the full chain down to 1x1
+	texture.mipLevels = 1;
+	while(std::max(texture.width, texture.height) >> texture.mipLevels)
+	{
+		++texture.mipLevels;
+	}
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = {texture.width, texture.height, 1};
+	imageInfo.mipLevels = texture.mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if(!allocator->CreateImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.allocation))
+	{
+		texture.decoded.error = "out of device memory";
+		return false;
+	}
+	texture.view = CreateView(device, texture.image, texture.mipLevels);
+	return true;
+}
+
+
+bool TextureStreamer::UploadPreview(uint32_t frame, Texture &texture)
+{
+	DecodedImage &decoded = texture.decoded;
+	uint32_t offset;
+	void* mapped = staging.Allocate(decoded.preview.size(), offset);
+	if(!mapped)
+	{
+		return false;
+	}
+	std::memcpy(mapped, decoded.preview.data(), decoded.preview.size());
+
+	const VkCommandBuffer cmd = BeginCommands(frame);
+	const uint32_t level = decoded.previewLevel;
+	ImageBarrier(cmd, texture.image, 0, texture.mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = offset;
+	region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+	region.imageExtent = {decoded.previewWidth, decoded.previewHeight, 1};
+	vkCmdCopyBufferToImage(cmd, staging.Buffer(), texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	//every other level is scaled from the preview, the larger ones blurry until level 0 arrives
+	ImageBarrier(cmd, texture.image, level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	for(uint32_t x = 0; x < texture.mipLevels; ++x)
+	{
+		if(x != level)
+		{
+			BlitLevel(cmd, texture.image, texture.width, texture.height, level, x);
+		}
+	}
+
+	ImageBarrier(cmd, texture.image, level, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	if(level)
+	{
+		ImageBarrier(cmd, texture.image, 0, level, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+	if(level + 1 < texture.mipLevels)
+	{
+		ImageBarrier(cmd, texture.image, level + 1, texture.mipLevels - level - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	decoded.preview = std::vector<uint8_t>();
+	texture.viewFrame = frame;
+
+	//a preview at level 0 is the whole image
+	texture.state = level ? TextureState::Preview : TextureState::Resident;
+	if(!level)
+	{
+		decoded = DecodedImage();
+	}
+	return true;
+}
+
+
+bool TextureStreamer::UploadRows(uint32_t frame, Texture &texture, uint32_t rows)
+{
+	const VkDeviceSize rowSize = VkDeviceSize(texture.width) * 4;
+	uint32_t offset;
+	void* mapped = staging.Allocate(rows * rowSize, offset);
+	if(!mapped)
+	{
+		return false;
+	}
+	std::memcpy(mapped, texture.decoded.pixels.data() + texture.rowsUploaded * rowSize, rows * rowSize);
+
+	//frames submitted earlier may still sample level 0, the copy waits for them
+	const VkCommandBuffer cmd = BeginCommands(frame);
+	ImageBarrier(cmd, texture.image, 0, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = offset;
+	region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.imageOffset = {0, int32_t(texture.rowsUploaded), 0};
+	region.imageExtent = {texture.width, rows, 1};
+	vkCmdCopyBufferToImage(cmd, staging.Buffer(), texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	texture.rowsUploaded += rows;
+
+	if(texture.rowsUploaded < texture.height)
+	{
+		ImageBarrier(cmd, texture.image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		return true;
+	}
+
+	GenerateMips(cmd, texture);
+	texture.decoded = DecodedImage();
+	texture.state = TextureState::Resident;
+	return true;
+}
+
+
+//level 0 in TRANSFER_DST_OPTIMAL, the others in SHADER_READ_ONLY_OPTIMAL holding the upscaled preview.
+//each level is blitted from the one above, so every blit reads a finished level
+void TextureStreamer::GenerateMips(VkCommandBuffer cmd, const Texture &texture)
+{
+	ImageBarrier(cmd, texture.image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	for(uint32_t x = 1; x < texture.mipLevels; ++x)
+	{
+		ImageBarrier(cmd, texture.image, x, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		BlitLevel(cmd, texture.image, texture.width, texture.height, x - 1, x);
+		ImageBarrier(cmd, texture.image, x, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	}
+	ImageBarrier(cmd, texture.image, 0, texture.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+
+VkCommandBuffer TextureStreamer::BeginCommands(uint32_t frame)
+{
+	if(!recording)
+	{
+		//the frame's fence has signalled, so has its last upload buffer
+		vkResetCommandPool(device, pools[frame], 0);
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffers[frame], &beginInfo);
+		recording = true;
+	}
+	return commandBuffers[frame];
+}
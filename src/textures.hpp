@@ -0,0 +1,117 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "allocator.hpp"
+#include "descriptors.hpp"
+#include "threadpool.hpp"
+#include "uniforms.hpp"
+
+
+typedef uint32_t TextureHandle; //index into the streamer's textures, 0xFFFFFFFF is no texture
+
+enum class TextureState
+{
+	Loading, //being read and decoded on a loader thread
+	Preview, //the preview level is resident and scaled into every mip, level 0 is streaming in
+	Resident, //every level holds real data
+	Failed,
+};
+
+//rgba8 pixels of level 0. the loader threads add a box filtered copy of the
+//first level no larger than the preview size
+struct DecodedImage
+{
+	uint32_t width = 0, height = 0;
+	std::vector<uint8_t> pixels;
+	uint32_t previewLevel = 0, previewWidth = 0, previewHeight = 0;
+	std::vector<uint8_t> preview;
+	std::string error; //set instead of the pixels when loading failed
+};
+
+//binary ppm (P6) and truecolour tga (raw or rle, 24 or 32 bit), there's no image library to lean on.
+//headers are checked against maxDimension and the data's size before anything is allocated
+bool DecodeImage(const uint8_t* data, size_t size, DecodedImage &image, uint32_t maxDimension = 0xFFFFFFFF);
+
+//textures are decoded on loader threads and streamed in over several frames. the first upload
+//is a small preview scaled into every mip, so the texture can be drawn right away. level 0 then
+//follows in row bands, at most frameBudget bytes per frame, and once it's complete the
+//rest of the chain is regenerated from it with vkCmdBlitImage. until the preview's upload has
+//finished a texture is drawn with the shared placeholder index, then its view is added to the table
+//at an index of its own. frames in flight never see a descriptor change under them, but draws
+//have to be recorded again to pick up the new index
+class TextureStreamer
+{
+	public:
+		//uploads are recorded for queueFamily, which needs graphics for the blits
+		void Create(VkDevice device, VkPhysicalDevice physicalDevice, DeviceAllocator &allocator, DescriptorTable &table,
+					uint32_t queueFamily, uint32_t frameCount, VkDeviceSize frameBudget, uint32_t threadCount);
+		//the device has to be idle
+		void Destroy();
+
+		TextureHandle Load(const std::string &path);
+
+		//call once frame's fence has signalled. records this frame's share of the uploads,
+		//to be submitted ahead of anything sampling the textures. null when there was nothing to do
+		VkCommandBuffer Update(uint32_t frame);
+
+		//what shaders index the resource table with this frame. the placeholder's until the preview is
+		//resident, and for good when loading fails or the table is full. 0xFFFFFFFF for a bad handle
+		uint32_t TableIndex(TextureHandle handle) const;
+		TextureState State(TextureHandle handle) const;
+		//finest level holding real data, the mip count while nothing does. 0xFFFFFFFF for a bad handle
+		uint32_t ResidentMip(TextureHandle handle) const;
+
+		uint32_t previewSize = 32; //largest side of the preview level
+
+	private:
+		struct Texture
+		{
+			std::string path;
+			std::future<DecodedImage> decode;
+			DecodedImage decoded; //dropped once resident
+			TextureState state = TextureState::Loading;
+
+			VkImage image = 0;
+			Allocation allocation;
+			VkImageView view = 0;
+			uint32_t width = 0, height = 0, mipLevels = 1;
+			uint32_t tableIndex = 0xFFFFFFFF; //the view's own, once the preview is resident
+			uint32_t viewFrame = 0xFFFFFFFF; //frame whose preview upload the view waits on before it's in the table
+			uint32_t rowsUploaded = 0; //of level 0
+		};
+
+		bool CreateImage(Texture &texture);
+		//both return false when the frame's staging slot is full
+		bool UploadPreview(uint32_t frame, Texture &texture);
+		bool UploadRows(uint32_t frame, Texture &texture, uint32_t rows);
+		void GenerateMips(VkCommandBuffer cmd, const Texture &texture);
+		VkCommandBuffer BeginCommands(uint32_t frame);
+
+		std::vector<Texture> textures;
+		ThreadPool loaders;
+		UniformRing staging; //one slot per frame in flight, reused once its fence has signalled
+		VkDeviceSize frameBudget = 0;
+		uint32_t maxDimension = 0;
+
+		//keeps every table element valid without partially bound descriptors
+		VkImage placeholder = 0;
+		Allocation placeholderAllocation;
+		VkImageView placeholderView = 0;
+		uint32_t placeholderIndex = 0xFFFFFFFF;
+		bool placeholderCleared = false;
+
+		std::vector<VkCommandPool> pools; //per frame in flight
+		std::vector<VkCommandBuffer> commandBuffers;
+		bool recording = false;
+
+		VkDevice device = 0;
+		DeviceAllocator* allocator = 0;
+		DescriptorTable* table = 0;
+		VkSampler sampler = 0;
+};
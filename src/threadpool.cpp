@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "threadpool.hpp"
+
+
+void ThreadPool::Create(uint32_t threadCount)
+{
+	if(!threadCount)
+	{
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	stopping = false;
+	for(uint32_t x = 0; x < threadCount; ++x)
+	{
+		threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+
+void ThreadPool::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	for(auto &v : threads)
+	{
+		v.join();
+	}
+	threads.clear();
+}
+
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)> &function)
+{
+	if(threads.empty())
+	{
+		for(uint32_t x = 0; x < count; ++x)
+		{
+			function(x);
+		}
+		return;
+	}
+
+	std::vector<std::future<void>> results;
+	results.reserve(count);
+	for(uint32_t x = 0; x < count; ++x)
+	{
+		results.push_back(Submit([&function, x]() { function(x); }));
+	}
+	for(auto &v : results)
+	{
+		v.wait();
+	}
+}
+
+
+void ThreadPool::Push(std::function<void()> &&job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(job));
+	}
+	condition.notify_one();
+}
+
+
+void ThreadPool::WorkerLoop()
+{
+	while(true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if(stopping && jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
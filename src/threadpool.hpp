@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+//fixed set of worker threads pulling jobs from one queue
+class ThreadPool
+{
+	public:
+		ThreadPool() = default;
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool &operator=(const ThreadPool&) = delete;
+		~ThreadPool() { Destroy(); }
+
+		//0 uses one thread per hardware thread
+		void Create(uint32_t threadCount = 0);
+		void Destroy();
+		uint32_t Size() const { return threads.size(); }
+
+		template<typename F>
+		auto Submit(F &&function) -> std::future<decltype(function())>
+		{
+			typedef decltype(function()) Result;
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+			std::future<Result> result = task->get_future();
+			Push([task]() { (*task)(); });
+			return result;
+		}
+
+		//runs function(x) for x in [0, count) spread over the workers and returns once all are done
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)> &function);
+
+	private:
+		void Push(std::function<void()> &&job);
+		void WorkerLoop();
+
+		std::vector<std::thread> threads;
+		std::queue<std::function<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping = false;
+};
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <algorithm>
+
+#include "uniforms.hpp"
+
+
+bool UniformRing::Create(DeviceAllocator &allocator, VkPhysicalDevice physicalDevice, uint32_t slotCount, VkDeviceSize slotSize,
+						 VkBufferUsageFlags usage)
+{
+	//16 also covers the texel size of any buffer to image copy
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+
+	//every slot starts on an aligned offset
+	this->slotSize = (slotSize + alignment - 1) / alignment * alignment;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = this->slotSize * slotCount;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if(!allocator.CreateBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+							   AllocationStrategy::FreeList, buffer, allocation))
+	{
+		std::cout << "Couldn't create a " << slotSize * slotCount / 1024 << "KiB ring\n";
+		return false;
+	}
+
+	mapped = static_cast<uint8_t*>(allocation.mapped);
+	if(!mapped)
+	{
+		std::cout << "Couldn't map the ring\n";
+		allocator.DestroyBuffer(buffer, allocation);
+		return false;
+	}
+	this->slotCount = slotCount;
+	BeginSlot(0);
+	return true;
+}
+
+
+void UniformRing::Destroy(DeviceAllocator &allocator)
+{
+	allocator.DestroyBuffer(buffer, allocation);
+	mapped = 0;
+	slotCount = 0;
+}
+
+
+void UniformRing::BeginSlot(uint32_t slot)
+{
+	//a slot the ring doesn't have is empty, everything allocated from it fails
+	if(slot >= slotCount)
+	{
+		head = end = 0;
+		return;
+	}
+	head = slot * slotSize;
+	end = head + slotSize;
+}
+
+
+void* UniformRing::Allocate(VkDeviceSize size, uint32_t &offset)
+{
+	if(!mapped || head + size > end)
+	{
+		return 0;
+	}
+
+	offset = uint32_t(head);
+	head = std::min(end, (head + size + alignment - 1) / alignment * alignment);
+	return mapped + offset;
+}
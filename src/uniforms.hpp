@@ -0,0 +1,41 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "allocator.hpp"
+
+
+//one persistently mapped, host coherent buffer split into a partition per recording slot.
+//a slot is bump allocated from its start and reset once its last submission has retired,
+//so per frame data costs a memcpy: no allocation, no map and no descriptor write.
+//with TRANSFER_SRC usage it doubles as a per frame staging arena
+class UniformRing
+{
+	public:
+		bool Create(DeviceAllocator &allocator, VkPhysicalDevice physicalDevice, uint32_t slotCount, VkDeviceSize slotSize,
+					VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+		void Destroy(DeviceAllocator &allocator);
+
+		//call once slot's fence has signalled, everything allocated from it before is reused
+		void BeginSlot(uint32_t slot);
+		//aligned for a dynamic uniform offset into Buffer() and for copies. null when the slot is full
+		void* Allocate(VkDeviceSize size, uint32_t &offset);
+		template<typename T>
+		T* Allocate(uint32_t &offset) { return static_cast<T*>(Allocate(sizeof(T), offset)); }
+		//count consecutive T's, e.g. a batch of Mat4s written straight by the vecmath kernels
+		template<typename T>
+		T* Allocate(uint32_t count, uint32_t &offset) { return static_cast<T*>(Allocate(VkDeviceSize(sizeof(T)) * count, offset)); }
+
+		VkBuffer Buffer() const { return buffer; }
+		uint32_t SlotOffset(uint32_t slot) const { return uint32_t(slot * slotSize); } //the first allocation after BeginSlot
+		uint32_t SlotCount() const { return slotCount; }
+
+	private:
+		VkBuffer buffer = 0;
+		Allocation allocation;
+		uint8_t* mapped = 0;
+		VkDeviceSize slotSize = 0, alignment = 1;
+		VkDeviceSize head = 0, end = 0; //bump range of the current slot
+		uint32_t slotCount = 0;
+};
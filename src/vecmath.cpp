@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "vecmath.hpp"
+
+
+Vec3 Normalize(const Vec3 &v)
+{
+	const float length = std::sqrt(Dot(v, v));
+	return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+
+Quat Normalize(const Quat &q)
+{
+	const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+	return {q.x * scale, q.y * scale, q.z * scale, q.w * scale};
+}
+
+
+Quat AxisAngle(const Vec3 &axis, float angle)
+{
+	const Vec3 a = Normalize(axis) * std::sin(angle * 0.5f);
+	return {a.x, a.y, a.z, std::cos(angle * 0.5f)};
+}
+
+
+Quat operator*(const Quat &a, const Quat &b)
+{
+	return {
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+
+Vec3 Rotate(const Quat &q, const Vec3 &v)
+{
+	//v + 2w(u x v) + 2u x (u x v), u being the vector part
+	const Vec3 u = {q.x, q.y, q.z};
+	const Vec3 t = Cross(u, v) * 2.0f;
+	return v + t * q.w + Cross(u, t);
+}
+
+
+Mat4 Identity()
+{
+	return {{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+}
+
+
+#ifdef __SSE2__
+//one column of a * b is a's columns weighted by that column of b. copy, when given, is stored
+//from the same registers, reading a matrix back right after storing it stalls on store forwarding
+static inline void MultiplySse(const float* a, const float* b, float* out, float* copy)
+{
+	const __m128 a0 = _mm_load_ps(a), a1 = _mm_load_ps(a + 4), a2 = _mm_load_ps(a + 8), a3 = _mm_load_ps(a + 12);
+	for(uint32_t x = 0; x < 16; x += 4)
+	{
+		const __m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[x])), _mm_mul_ps(a1, _mm_set1_ps(b[x + 1]))),
+			_mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[x + 2])), _mm_mul_ps(a3, _mm_set1_ps(b[x + 3]))));
+		_mm_store_ps(out + x, column);
+		if(copy)
+		{
+			_mm_store_ps(copy + x, column);
+		}
+	}
+}
+#endif
+
+
+#ifdef __AVX2__
+//two columns at a time, a's columns are repeated in both halves and each half picks its own column of b
+static inline void MultiplyAvx(const float* a, const float* b, float* out, float* copy)
+{
+	const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+	const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+	const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+	const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+	for(uint32_t x = 0; x < 16; x += 8)
+	{
+		const __m256 columns = _mm256_loadu_ps(b + x);
+		const __m256 result = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(a0, _mm256_permute_ps(columns, _MM_SHUFFLE(0, 0, 0, 0))), _mm256_mul_ps(a1, _mm256_permute_ps(columns, _MM_SHUFFLE(1, 1, 1, 1)))),
+			_mm256_add_ps(_mm256_mul_ps(a2, _mm256_permute_ps(columns, _MM_SHUFFLE(2, 2, 2, 2))), _mm256_mul_ps(a3, _mm256_permute_ps(columns, _MM_SHUFFLE(3, 3, 3, 3)))));
+		_mm256_storeu_ps(out + x, result);
+		if(copy)
+		{
+			_mm256_storeu_ps(copy + x, result);
+		}
+	}
+}
+#endif
+
+
+static inline void Multiply(const float* a, const float* b, float* out, float* copy = 0)
+{
+#if defined(__AVX2__)
+	MultiplyAvx(a, b, out, copy);
+#elif defined(__SSE2__)
+	MultiplySse(a, b, out, copy);
+#else
+	float result[16];
+	for(uint32_t x = 0; x < 16; x += 4)
+	{
+		for(uint32_t y = 0; y < 4; ++y)
+		{
+			result[x + y] = (a[y] * b[x] + a[4 + y] * b[x + 1]) + (a[8 + y] * b[x + 2] + a[12 + y] * b[x + 3]);
+		}
+	}
+	std::copy(result, result + 16, out);
+	if(copy)
+	{
+		std::copy(result, result + 16, copy);
+	}
+#endif
+}
+
+
+Mat4 operator*(const Mat4 &a, const Mat4 &b)
+{
+	Mat4 result;
+	Multiply(a.m, b.m, result.m);
+	return result;
+}
+
+
+Vec4 operator*(const Mat4 &m, const Vec4 &v)
+{
+	const float* a = m.m;
+	return {
+		a[0] * v.x + a[4] * v.y + a[8] * v.z + a[12] * v.w,
+		a[1] * v.x + a[5] * v.y + a[9] * v.z + a[13] * v.w,
+		a[2] * v.x + a[6] * v.y + a[10] * v.z + a[14] * v.w,
+		a[3] * v.x + a[7] * v.y + a[11] * v.z + a[15] * v.w};
+}
+
+
+//the rotation's columns scaled by the scale's components, the translation in the last column.
+//the batch kernels do the same operations in the same order. the compiler may fuse any of them
+//into fma, in either path, so results can still differ in the last bit
+static inline void Compose(float tx, float ty, float tz, float qx, float qy, float qz, float qw, float sx, float sy, float sz, float* out)
+{
+	const float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+	const float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+	const float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+	out[0] = sx * (1.0f - 2.0f * (yy + zz));
+	out[1] = sx * (2.0f * (xy + wz));
+	out[2] = sx * (2.0f * (xz - wy));
+	out[3] = 0.0f;
+	out[4] = sy * (2.0f * (xy - wz));
+	out[5] = sy * (1.0f - 2.0f * (xx + zz));
+	out[6] = sy * (2.0f * (yz + wx));
+	out[7] = 0.0f;
+	out[8] = sz * (2.0f * (xz + wy));
+	out[9] = sz * (2.0f * (yz - wx));
+	out[10] = sz * (1.0f - 2.0f * (xx + yy));
+	out[11] = 0.0f;
+	out[12] = tx;
+	out[13] = ty;
+	out[14] = tz;
+	out[15] = 1.0f;
+}
+
+
+Mat4 Compose(const Vec3 &translation, const Quat &rotation, const Vec3 &scale)
+{
+	Mat4 result;
+	Compose(translation.x, translation.y, translation.z, rotation.x, rotation.y, rotation.z, rotation.w, scale.x, scale.y, scale.z, result.m);
+	return result;
+}
+
+
+Mat4 Perspective(float fovY, float aspect, float near, float far)
+{
+	const float f = 1.0f / std::tan(fovY * 0.5f);
+	Mat4 result = {};
+	result.m[0] = f / aspect;
+	result.m[5] = -f;
+	result.m[10] = far / (near - far);
+	result.m[11] = -1.0f;
+	result.m[14] = near * far / (near - far);
+	return result;
+}
+
+
+Mat4 LookAt(const Vec3 &eye, const Vec3 &target, const Vec3 &up)
+{
+	const Vec3 forward = Normalize(target - eye);
+	const Vec3 right = Normalize(Cross(forward, up));
+	const Vec3 newUp = Cross(right, forward);
+	return {{
+		right.x, newUp.x, -forward.x, 0.0f,
+		right.y, newUp.y, -forward.y, 0.0f,
+		right.z, newUp.z, -forward.z, 0.0f,
+		-Dot(right, eye), -Dot(newUp, eye), Dot(forward, eye), 1.0f}};
+}
+
+
+const char* MathKernelName()
+{
+#if defined(__AVX2__)
+	return "avx2";
+#elif defined(__SSE2__)
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
+
+
+void TransformArrays::Resize(uint32_t count)
+{
+	for(auto &v : translation)
+	{
+		v.resize(count, 0.0f);
+	}
+	for(uint32_t x = 0; x < 4; ++x)
+	{
+		rotation[x].resize(count, x == 3 ? 1.0f : 0.0f);
+	}
+	for(auto &v : scale)
+	{
+		v.resize(count, 1.0f);
+	}
+}
+
+
+void TransformArrays::Set(uint32_t index, const Vec3 &translation, const Quat &rotation, const Vec3 &scale)
+{
+	this->translation[0][index] = translation.x;
+	this->translation[1][index] = translation.y;
+	this->translation[2][index] = translation.z;
+	this->rotation[0][index] = rotation.x;
+	this->rotation[1][index] = rotation.y;
+	this->rotation[2][index] = rotation.z;
+	this->rotation[3][index] = rotation.w;
+	this->scale[0][index] = scale.x;
+	this->scale[1][index] = scale.y;
+	this->scale[2][index] = scale.z;
+}
+
+
+void ComposeTransforms(const TransformArrays &transforms, Mat4* out)
+{
+	const uint32_t count = transforms.Size();
+	const float* tx = transforms.translation[0].data(), *ty = transforms.translation[1].data(), *tz = transforms.translation[2].data();
+	const float* qx = transforms.rotation[0].data(), *qy = transforms.rotation[1].data(), *qz = transforms.rotation[2].data(), *qw = transforms.rotation[3].data();
+	const float* sx = transforms.scale[0].data(), *sy = transforms.scale[1].data(), *sz = transforms.scale[2].data();
+	uint32_t x = 0;
+
+#if defined(__AVX2__)
+	//16 registers each hold one matrix element for 8 objects, two 8x8 transposes turn
+	//them into the first and second halves of the 8 matrices
+	const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+	for(; x + 8 <= count; x += 8)
+	{
+		const __m256 x8 = _mm256_load_ps(qx + x), y8 = _mm256_load_ps(qy + x), z8 = _mm256_load_ps(qz + x), w8 = _mm256_load_ps(qw + x);
+		const __m256 xx = _mm256_mul_ps(x8, x8), yy = _mm256_mul_ps(y8, y8), zz = _mm256_mul_ps(z8, z8);
+		const __m256 xy = _mm256_mul_ps(x8, y8), xz = _mm256_mul_ps(x8, z8), yz = _mm256_mul_ps(y8, z8);
+		const __m256 wx = _mm256_mul_ps(w8, x8), wy = _mm256_mul_ps(w8, y8), wz = _mm256_mul_ps(w8, z8);
+		const __m256 scaleX = _mm256_load_ps(sx + x), scaleY = _mm256_load_ps(sy + x), scaleZ = _mm256_load_ps(sz + x);
+
+		__m256 e[16] = {
+			_mm256_mul_ps(scaleX, _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz)))),
+			_mm256_mul_ps(scaleX, _mm256_mul_ps(two, _mm256_add_ps(xy, wz))),
+			_mm256_mul_ps(scaleX, _mm256_mul_ps(two, _mm256_sub_ps(xz, wy))),
+			zero,
+			_mm256_mul_ps(scaleY, _mm256_mul_ps(two, _mm256_sub_ps(xy, wz))),
+			_mm256_mul_ps(scaleY, _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz)))),
+			_mm256_mul_ps(scaleY, _mm256_mul_ps(two, _mm256_add_ps(yz, wx))),
+			zero,
+			_mm256_mul_ps(scaleZ, _mm256_mul_ps(two, _mm256_add_ps(xz, wy))),
+			_mm256_mul_ps(scaleZ, _mm256_mul_ps(two, _mm256_sub_ps(yz, wx))),
+			_mm256_mul_ps(scaleZ, _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)))),
+			zero,
+			_mm256_load_ps(tx + x),
+			_mm256_load_ps(ty + x),
+			_mm256_load_ps(tz + x),
+			one};
+
+		for(uint32_t half = 0; half < 16; half += 8)
+		{
+			__m256* r = e + half;
+			const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+			const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+			const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+			const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+			const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+			r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+			r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+			r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+			r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+			r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+			r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+			r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+			r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+		}
+
+		//whole matrices in order, out is only 16 byte aligned
+		for(uint32_t y = 0; y < 8; ++y)
+		{
+			_mm256_storeu_ps(out[x + y].m, e[y]);
+			_mm256_storeu_ps(out[x + y].m + 8, e[8 + y]);
+		}
+	}
+#elif defined(__SSE2__)
+	//4 objects at a time, the element registers are transposed 4 at a time into matrix columns
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	for(; x + 4 <= count; x += 4)
+	{
+		const __m128 x4 = _mm_load_ps(qx + x), y4 = _mm_load_ps(qy + x), z4 = _mm_load_ps(qz + x), w4 = _mm_load_ps(qw + x);
+		const __m128 xx = _mm_mul_ps(x4, x4), yy = _mm_mul_ps(y4, y4), zz = _mm_mul_ps(z4, z4);
+		const __m128 xy = _mm_mul_ps(x4, y4), xz = _mm_mul_ps(x4, z4), yz = _mm_mul_ps(y4, z4);
+		const __m128 wx = _mm_mul_ps(w4, x4), wy = _mm_mul_ps(w4, y4), wz = _mm_mul_ps(w4, z4);
+		const __m128 scaleX = _mm_load_ps(sx + x), scaleY = _mm_load_ps(sy + x), scaleZ = _mm_load_ps(sz + x);
+
+		__m128 e[16] = {
+			_mm_mul_ps(scaleX, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)))),
+			_mm_mul_ps(scaleX, _mm_mul_ps(two, _mm_add_ps(xy, wz))),
+			_mm_mul_ps(scaleX, _mm_mul_ps(two, _mm_sub_ps(xz, wy))),
+			zero,
+			_mm_mul_ps(scaleY, _mm_mul_ps(two, _mm_sub_ps(xy, wz))),
+			_mm_mul_ps(scaleY, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)))),
+			_mm_mul_ps(scaleY, _mm_mul_ps(two, _mm_add_ps(yz, wx))),
+			zero,
+			_mm_mul_ps(scaleZ, _mm_mul_ps(two, _mm_add_ps(xz, wy))),
+			_mm_mul_ps(scaleZ, _mm_mul_ps(two, _mm_sub_ps(yz, wx))),
+			_mm_mul_ps(scaleZ, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))),
+			zero,
+			_mm_load_ps(tx + x),
+			_mm_load_ps(ty + x),
+			_mm_load_ps(tz + x),
+			one};
+
+		for(uint32_t column = 0; column < 16; column += 4)
+		{
+			_MM_TRANSPOSE4_PS(e[column], e[column + 1], e[column + 2], e[column + 3]);
+		}
+		for(uint32_t y = 0; y < 4; ++y)
+		{
+			for(uint32_t column = 0; column < 4; ++column)
+			{
+				_mm_store_ps(out[x + y].m + column * 4, e[column * 4 + y]);
+			}
+		}
+	}
+#endif
+
+	//the remainder, or everything without simd
+	for(; x < count; ++x)
+	{
+		Compose(tx[x], ty[x], tz[x], qx[x], qy[x], qz[x], qw[x], sx[x], sy[x], sz[x], out[x].m);
+	}
+}
+
+
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, uint32_t count)
+{
+	for(uint32_t x = 0; x < count; ++x)
+	{
+		Multiply(a[x].m, b[x].m, out[x].m);
+	}
+}
+
+
+void PropagateHierarchy(const int32_t* parents, const Mat4* local, Mat4* world, uint32_t count, Mat4* upload)
+{
+	//in memory order: a parent is usually finished long before its children come up, so the loop
+	//is bound by multiply throughput rather than waiting on parents, and the arrays stream.
+	//the upload copy comes from the registers the result was computed in
+	for(uint32_t x = 0; x < count; ++x)
+	{
+		if(parents[x] < 0)
+		{
+			world[x] = local[x];
+			if(upload)
+			{
+				upload[x] = local[x];
+			}
+		}
+		else
+		{
+			Multiply(world[parents[x]].m, local[x].m, world[x].m, upload ? upload[x].m : 0);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include "aligned.hpp"
+
+
+//every type is 16 bytes aligned and a whole number of simd registers. matrices are column major
+//(m[column * 4 + row]) like glsl, so arrays of them go into std140 and std430 buffers unchanged
+struct alignas(16) Vec3
+{
+	float x, y, z;
+	float padding = 0.0f;
+};
+
+struct alignas(16) Vec4
+{
+	float x, y, z, w;
+};
+
+//unit quaternion, w is the real part
+struct alignas(16) Quat
+{
+	float x, y, z, w;
+};
+
+struct alignas(16) Mat4
+{
+	float m[16];
+};
+
+inline Vec3 operator+(const Vec3 &a, const Vec3 &b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3 operator-(const Vec3 &a, const Vec3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3 operator*(const Vec3 &a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+inline float Dot(const Vec3 &a, const Vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(const Vec3 &a, const Vec3 &b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+Vec3 Normalize(const Vec3 &v);
+
+Quat Normalize(const Quat &q);
+Quat AxisAngle(const Vec3 &axis, float angle);
+Quat operator*(const Quat &a, const Quat &b); //b's rotation first
+Vec3 Rotate(const Quat &q, const Vec3 &v);
+
+Mat4 Identity();
+Mat4 operator*(const Mat4 &a, const Mat4 &b); //b's transform first
+Vec4 operator*(const Mat4 &m, const Vec4 &v);
+//scale, then rotate, then translate
+Mat4 Compose(const Vec3 &translation, const Quat &rotation, const Vec3 &scale);
+//right handed, looking down -z, into vulkan's clip space: y down and depth from 0 to 1
+Mat4 Perspective(float fovY, float aspect, float near, float far);
+Mat4 LookAt(const Vec3 &eye, const Vec3 &target, const Vec3 &up);
+
+//the widest instruction set the batch kernels were compiled for (-march=native)
+const char* MathKernelName();
+
+//transforms as structure of arrays, so the batch kernels load 8 (avx2) or 4 (sse) of each component at once
+struct TransformArrays
+{
+	AlignedVector<float> translation[3], rotation[4], scale[3];
+
+	void Resize(uint32_t count);
+	uint32_t Size() const { return translation[0].size(); }
+	void Set(uint32_t index, const Vec3 &translation, const Quat &rotation, const Vec3 &scale);
+};
+
+//the batch kernels only store to out, whole matrices in order, so it can be a mapped
+//per frame buffer (UniformRing::Allocate) without anything being read back from it.
+//out needs 16 byte alignment and may not overlap the inputs
+void ComposeTransforms(const TransformArrays &transforms, Mat4* out);
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, uint32_t count); //out[x] = a[x] * b[x]
+//world[x] = world[parents[x]] * local[x], parents come before their children and roots have -1.
+//world is read back for the children, so it should be cached memory. upload, when given, gets a
+//copy of every result as it's computed, which is where a mapped buffer goes
+void PropagateHierarchy(const int32_t* parents, const Mat4* local, Mat4* world, uint32_t count, Mat4* upload = 0);
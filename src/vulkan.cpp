@@ -3,16 +3,88 @@
 #include <iostream>
 #include <array>
 #include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 #include "vulkan.hpp"
 #include "file.hpp"
+#include "shaders.hpp"
 
 
-#ifdef NDEBUG
-	const bool enableValidationLayers = false;
-#else
-	const bool enableValidationLayers = true;
-#endif
+const std::vector<Vertex> triangleVertices
+{
+	{{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+	{{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+	{{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
+};
+
+const std::vector<uint16_t> triangleIndices{0, 1, 2};
+
+//what RecordDraws pushes for a DrawCommand, its texture resolved to the table index
+struct DrawConstants
+{
+	float tint[4];
+	uint32_t textureIndex;
+};
+
+
+static uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+	const uint32_t mantissa = bits & 0x7FFFFF;
+
+	if(exponent <= 0)
+	{
+		return sign; //flush denormals to zero
+	}
+	if(exponent >= 31)
+	{
+		return sign | 0x7C00;
+	}
+	//round to nearest
+	return sign | (exponent << 10) | ((mantissa + 0x1000) >> 13);
+}
+
+
+static int16_t FloatToSnorm16(float value)
+{
+	value = std::max(-1.0f, std::min(1.0f, value));
+	return int16_t(std::lround(value * 32767.0f));
+}
+
+
+//a square grid of small spinning triangles covering the viewport
+static std::vector<InstanceData> CreateStressScene(uint32_t count)
+{
+	std::vector<InstanceData> instances(count);
+	const uint32_t side = uint32_t(std::ceil(std::sqrt(double(count))));
+	const float cell = 2.0f / side;
+
+	for(uint32_t x = 0; x < count; ++x)
+	{
+		const uint32_t column = x % side, row = x / side;
+		const float u = (column + 0.5f) / side, v = (row + 0.5f) / side;
+
+		InstanceData &instance = instances[x];
+		instance.pos[0] = FloatToSnorm16(u * 2.0f - 1.0f);
+		instance.pos[1] = FloatToSnorm16(v * 2.0f - 1.0f);
+		instance.scale = FloatToHalf(cell * 0.9f);
+		instance.rotation = FloatToHalf((x % 360) * 0.0174533f);
+		instance.color[0] = uint8_t(u * 255.0f);
+		instance.color[1] = uint8_t(v * 255.0f);
+		instance.color[2] = uint8_t((1.0f - u) * 255.0f);
+		instance.color[3] = 255;
+	}
+
+	return instances;
+}
 
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -51,7 +123,7 @@ void Vulkan::CreateInstance()
 	instanceCreateInfo.enabledExtensionCount = extensions.size();
 	instanceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
-	if(enableValidationLayers)
+	if(validation)
 	{
 		if(CheckValidationLayerSupport())
 		{
@@ -76,14 +148,14 @@ void Vulkan::CreateInstance()
 
 void Vulkan::SetupDebugCallback()
 {
-	if(enableValidationLayers)
+	if(validation)
 	{
 		VkDebugReportCallbackCreateInfoEXT debugCreateInfo = {};
 		debugCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
 		debugCreateInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
 		debugCreateInfo.pfnCallback = debugCallback;
 
-		PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT) glfwGetInstanceProcAddress(instance, "vkCreateDebugReportCallbackEXT");
+		PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT) vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
 		if(vkCreateDebugReportCallbackEXT)
 		{
 			VkResult asd = vkCreateDebugReportCallbackEXT(instance, &debugCreateInfo, 0, &callback);
@@ -98,6 +170,7 @@ void Vulkan::SetupDebugCallback()
 
 void Vulkan::CreateSurface(GLFWwindow* &window)
 {
+	this->window = window;
 	VkResult err = glfwCreateWindowSurface(instance, window, 0, &surface);
 	if(err)
 	{
@@ -119,49 +192,152 @@ void Vulkan::PickPhysicalDevice()
 	std::vector<VkPhysicalDevice> devices(deviceCount);
 	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-	if(IsDeviceSuitable(devices[0]))
+	std::string selection = deviceOverride;
+	if(selection.empty() && std::getenv("VKG_DEVICE"))
 	{
-		physicalDevice = devices[0];
+		selection = std::getenv("VKG_DEVICE");
 	}
-	else
+	std::transform(selection.begin(), selection.end(), selection.begin(), ::tolower);
+	const bool byIndex = !selection.empty() && selection.find_first_not_of("0123456789") == std::string::npos;
+
+	uint64_t bestScore = 0;
+	int selected = -1;
+	for(uint32_t x = 0; x < deviceCount; ++x)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(devices[x], &properties);
+		const uint64_t score = ScoreDevice(devices[x]);
+		if(verbose)
+		{
+			std::cout << "Device " << x << ": " << properties.deviceName << ", score " << score << "\n";
+		}
+
+		std::string name = properties.deviceName;
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		if(!selection.empty() && selected == -1 && (byIndex ? std::strtoul(selection.c_str(), 0, 10) == x : name.find(selection) != std::string::npos))
+		{
+			if(score)
+			{
+				selected = x;
+			}
+			else
+			{
+				std::cout << "Requested device " << properties.deviceName << " is not suitable, picking by score\n";
+			}
+		}
+
+		if(score > bestScore)
+		{
+			bestScore = score;
+			physicalDevice = devices[x];
+		}
+	}
+
+	if(selected != -1)
+	{
+		physicalDevice = devices[selected];
+	}
+	else if(!selection.empty())
+	{
+		std::cout << "No device matches \"" << selection << "\", picking by score\n";
+	}
+
+	if(!physicalDevice)
 	{
 		std::cout << "No suitable GPUs found!\n";
 		// exit(-1);
 	}
+	else if(verbose)
+	{
+		std::cout << "Using " << GetDeviceName() << "\n";
+	}
 }
 
 
 void Vulkan::CreateLogicalDevice()
 {
-	uint32_t queueFamilyCount;
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, 0);
-
-	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+	queueFamilies = FindQueueFamilies(physicalDevice);
 
-	int index = FindQueueFamily(physicalDevice);
+	//one queue from each distinct family
+	std::vector<int> uniqueFamilies{queueFamilies.graphics};
+	for(const int family : {queueFamilies.present, queueFamilies.transfer, queueFamilies.compute})
+	{
+		if(family != -1 && std::find(uniqueFamilies.begin(), uniqueFamilies.end(), family) == uniqueFamilies.end())
+		{
+			uniqueFamilies.push_back(family);
+		}
+	}
 
-	//
 	float queuePriority = 1.0f;
-	VkDeviceQueueCreateInfo queueCreateInfo = {};
-	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queueCreateInfo.queueFamilyIndex = index;
-	queueCreateInfo.queueCount = 1;
-	queueCreateInfo.pQueuePriorities = &queuePriority;
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	for(const auto &v : uniqueFamilies)
+	{
+		VkDeviceQueueCreateInfo queueCreateInfo = {};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = v;
+		queueCreateInfo.queueCount = 1;
+		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
 
-	//
+	//draws select their texture from the table by a push constant index
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
 	VkPhysicalDeviceFeatures deviceFeatures = {};
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+	if(!texturePaths.empty() && !supportedFeatures.shaderSampledImageArrayDynamicIndexing)
+	{
+		std::cout << "Dynamically indexed sampler arrays unsupported, drawing without textures\n";
+		texturePaths.clear();
+	}
+
+	//culled draws read their instances from their own range of the packed buffer
+	deviceFeatures.drawIndirectFirstInstance = gpuCulling && supportedFeatures.drawIndirectFirstInstance;
+	if(gpuCulling && (!instanceCount || !supportedFeatures.drawIndirectFirstInstance))
+	{
+		std::cout << (instanceCount ? "Indirect draws with a first instance unsupported" : "No instances to cull") << ", drawing without gpu culling\n";
+		gpuCulling = false;
+	}
+
+	std::vector<const char*> extensions;
+	if(!headless)
+	{
+		extensions = deviceExtensions;
+	}
+
+	if(bindless && !CheckBindlessSupport(physicalDevice))
+	{
+		std::cout << "Descriptor indexing unsupported, falling back to per frame descriptor sets\n";
+		bindless = false;
+	}
+
+	//what the bindless table needs: runtime sized, partially bound arrays updated while bound
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	if(bindless)
+	{
+		extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	}
 
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
-	deviceCreateInfo.queueCreateInfoCount = 1;
+	deviceCreateInfo.pNext = bindless ? &indexingFeatures : 0;
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+	deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 	deviceCreateInfo.enabledLayerCount = 0;
-	deviceCreateInfo.enabledExtensionCount = deviceExtensions.size();
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	deviceCreateInfo.enabledExtensionCount = extensions.size();
+	deviceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
-	if(enableValidationLayers)
+	if(validation)
 	{
 		deviceCreateInfo.enabledLayerCount = validationLayers.size();
 		deviceCreateInfo.ppEnabledLayerNames = validationLayers.data();
@@ -169,8 +345,22 @@ void Vulkan::CreateLogicalDevice()
 
 	vkCreateDevice(physicalDevice, &deviceCreateInfo, 0, &device);
 
-	vkGetDeviceQueue(device, index, 0, &graphicsQueue);
-	vkGetDeviceQueue(device, index, 0, &presentQueue);
+	vkGetDeviceQueue(device, queueFamilies.graphics, 0, &graphicsQueue);
+	vkGetDeviceQueue(device, queueFamilies.transfer, 0, &transferQueue);
+	vkGetDeviceQueue(device, queueFamilies.compute, 0, &computeQueue);
+	if(!headless)
+	{
+		vkGetDeviceQueue(device, queueFamilies.present, 0, &presentQueue);
+	}
+
+	if(verbose)
+	{
+		std::cout << "queue families: graphics " << queueFamilies.graphics << ", present " << queueFamilies.present
+				  << ", transfer " << queueFamilies.transfer << ", compute " << queueFamilies.compute << "\n";
+	}
+
+	allocator.Create(device, physicalDevice, maxFramesInFlight);
+	CreatePipelineCache();
 }
 
 
@@ -179,15 +369,17 @@ void Vulkan::CreateSwapchain()
 	SwapchainSupportDetails swapchainSupport = QuerySwapchainSupport(physicalDevice);
 
 	VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapchainSupport.formats);
-	VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapchainSupport.presentModes);
+	presentMode = ChooseSwapPresentMode(swapchainSupport.presentModes);
 	VkExtent2D extent = ChooseSwapExtent(swapchainSupport.capabilities);
 
-	// std::cout << "min: " << swapchainSupport.capabilities.minImageCount
-			  // << " max: " << swapchainSupport.capabilities.maxImageCount << "\n";
-	uint32_t imageCount = swapchainSupport.capabilities.minImageCount;
-	if(swapchainSupport.capabilities.maxImageCount > swapchainSupport.capabilities.minImageCount)
+	//one more than the minimum lets the cpu acquire while the engine holds the rest,
+	//fewer images means less queued frames and lower latency. maxImageCount 0 is unbounded
+	const VkSurfaceCapabilitiesKHR &capabilities = swapchainSupport.capabilities;
+	uint32_t imageCount = swapchainImageCount ? swapchainImageCount : capabilities.minImageCount + 1;
+	imageCount = std::max(imageCount, capabilities.minImageCount);
+	if(capabilities.maxImageCount)
 	{
-		++imageCount;
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
 	}
 
 	VkSwapchainCreateInfoKHR createInfo = {};
@@ -200,17 +392,26 @@ void Vulkan::CreateSwapchain()
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	int index = FindQueueFamily(physicalDevice);
-	// if (indices.graphicsFamily != indices.presentFamily) //use this later
-	createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	createInfo.queueFamilyIndexCount = 0;
-	createInfo.pQueueFamilyIndices = 0;
+	//rendered on one family and presented from another, let both use the images without ownership transfers
+	const std::array<uint32_t, 2> familyIndices{uint32_t(queueFamilies.graphics), uint32_t(queueFamilies.present)};
+	if(queueFamilies.graphics != queueFamilies.present)
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = familyIndices.size();
+		createInfo.pQueueFamilyIndices = familyIndices.data();
+	}
+	else
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		createInfo.queueFamilyIndexCount = 0;
+		createInfo.pQueueFamilyIndices = 0;
+	}
 
 	createInfo.preTransform = swapchainSupport.capabilities.currentTransform;
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = swapchain; //lets the driver reuse what it can, the caller retires the old handle
 
 	vkCreateSwapchainKHR(device, &createInfo, 0, &swapchain);
 
@@ -222,6 +423,35 @@ void Vulkan::CreateSwapchain()
 }
 
 
+void Vulkan::CreateOffscreenTarget()
+{
+	//stands in for the swapchain when running headless, one image per frame in flight
+	const uint32_t imageCount = maxFramesInFlight ? maxFramesInFlight : 1;
+	swapchainImages.resize(imageCount);
+	offscreenImageAllocations.resize(imageCount);
+	swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	swapchainExtent = headlessExtent;
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = swapchainImageFormat;
+	imageInfo.extent = {swapchainExtent.width, swapchainExtent.height, 1};
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	for(uint32_t x = 0; x < imageCount; ++x)
+	{
+		allocator.CreateImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapchainImages[x], offscreenImageAllocations[x]);
+	}
+}
+
+
 void Vulkan::CreateImageViews()
 {
 	swapchainImageViews.resize(swapchainImages.size());
@@ -248,608 +478,2444 @@ void Vulkan::CreateImageViews()
 }
 
 
-void Vulkan::CreateRenderPass()
+bool Vulkan::CreateRenderPass()
 {
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = swapchainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentRef = {};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subPass = {};
-	subPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subPass.colorAttachmentCount = 1;
-	subPass.pColorAttachments = &colorAttachmentRef;
-
-	VkRenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subPass;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-
-	vkCreateRenderPass(device, &renderPassInfo, 0, &renderPass);
+	//the frame as a graph: the scene pass clears and draws into an offscreen image with a depth
+	//buffer, and the present pass samples it into the swapchain image. the render passes, their
+	//layouts, the dependencies between them and on the acquire wait all follow from that. depth
+	//is never stored, so it's a transient attachment tilers can keep on chip
+	renderGraph.Create(device, allocator);
+	backbuffer = renderGraph.ImportImage("backbuffer", swapchainImageFormat,
+										 headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	sceneColor = renderGraph.CreateImage("scene", swapchainImageFormat);
+	sceneDepth = renderGraph.CreateImage("depth", VK_FORMAT_D16_UNORM);
+
+	scenePass = renderGraph.AddPass("scene");
+	const VkClearColorValue clearColor = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	const VkClearDepthStencilValue clearDepth = {1.0f, 0};
+	renderGraph.WriteColor(scenePass, sceneColor, &clearColor);
+	renderGraph.WriteDepth(scenePass, sceneDepth, &clearDepth);
+
+	//covers every pixel, nothing to clear
+	presentPass = renderGraph.AddPass("present");
+	renderGraph.Sample(presentPass, sceneColor);
+	renderGraph.WriteColor(presentPass, backbuffer);
+
+	if(!renderGraph.Compile())
+	{
+		std::cout << "Couldn't compile the render graph\n";
+		return false;
+	}
+	renderPass = renderGraph.RenderPass(scenePass);
+	return true;
 }
 
 
 void Vulkan::CreateGraphicsPipeline()
 {
-	const std::vector<uint32_t> vertShaderCode = FileToU32Vec("bin/vert.spv");
-	const std::vector<uint32_t> fragShaderCode = FileToU32Vec("bin/frag.spv");
-
-	VkShaderModule vertShaderModule, fragShaderModule;
-	CreateShaderModule(vertShaderCode, vertShaderModule);
-	CreateShaderModule(fragShaderCode, fragShaderModule);
-
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = vertShaderModule;
-	vertShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = fragShaderModule;
-	fragShaderStageInfo.pName = "main";
-
-	const std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{vertShaderStageInfo, fragShaderStageInfo};
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = 0;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = 0;
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = float(swapchainExtent.width);
-	viewport.height = float(swapchainExtent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = {0, 0};
-	scissor.extent = swapchainExtent;
-
-	VkPipelineViewportStateCreateInfo viewportState = {};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer = {};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasConstantFactor = 0.0f;
-	rasterizer.depthBiasClamp = 0.0f;
-	rasterizer.depthBiasSlopeFactor = 0.0f;
-
-	VkPipelineMultisampleStateCreateInfo multisampling = {};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisampling.minSampleShading = 1.0f;
-	multisampling.pSampleMask = 0;
-	multisampling.alphaToCoverageEnable = VK_FALSE;
-	multisampling.alphaToOneEnable = VK_FALSE;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending = {};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f;
-	colorBlending.blendConstants[1] = 0.0f;
-	colorBlending.blendConstants[2] = 0.0f;
-	colorBlending.blendConstants[3] = 0.0f;
+	//set 0 is the frame's uniforms, the dynamic offset picks the slot when binding
+	VkDescriptorSetLayoutBinding frameBinding = {};
+	frameBinding.binding = 0;
+	frameBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	frameBinding.descriptorCount = 1;
+	frameBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | (gpuCulling ? VK_SHADER_STAGE_COMPUTE_BIT : 0); //the cull shader reads the view
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &frameBinding;
+	vkCreateDescriptorSetLayout(device, &layoutInfo, 0, &frameSetLayout);
+
+	//the draw's tint and texture
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DrawConstants);
+
+	//set 1 is every texture and buffer, draws pick theirs by index. the bindless table is sized
+	//by the update after bind limits, which only the properties2 query reports
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	if(bindless)
+	{
+		PFN_vkGetPhysicalDeviceProperties2KHR vkGetPhysicalDeviceProperties2KHR = PFN_vkGetPhysicalDeviceProperties2KHR(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+		VkPhysicalDeviceProperties2KHR properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties);
+	}
+	resourceTable.Create(device, physicalDevice, bindless ? &indexingProperties : 0, tableImageCapacity, tableBufferCapacity);
+	const std::array<VkDescriptorSetLayout, 2> setLayouts{frameSetLayout, resourceTable.Layout()};
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pSetLayouts = 0;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = 0;
+	pipelineLayoutInfo.setLayoutCount = setLayouts.size();
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 	vkCreatePipelineLayout(device, &pipelineLayoutInfo, 0, &pipelineLayout);
 
-	VkGraphicsPipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages.data();
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = 0;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = 0;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	pipelineInfo.basePipelineIndex = -1;
+	pipelineBuilder.Create(device, pipelineCache, [this](const std::string &name, VkShaderModule &module)
+	{
+		CreateShaderModule(name, module);
+	}, pipelineThreads);
+
+	//binding 0 is per vertex, binding 1 per instance when instancing
+	PipelineVariant variant;
+	variant.vertexShader = instanceCount ? "instanced.vert" : "shader.vert";
+	if(!texturePaths.empty())
+	{
+		//statically uses every image in the table, so only with a texture streamer keeping them valid
+		variant.fragmentShader = "textured.frag";
+		variant.SetConstant(0, resourceTable.ImageCapacity());
+	}
+	variant.depthTest = true;
+	variant.layout = pipelineLayout;
+	variant.renderPass = renderPass;
+	variant.bindings.push_back(Vertex::GetBindingDescription());
+	for(const auto &v : Vertex::GetAttributeDescriptions())
+	{
+		variant.attributes.push_back(v);
+	}
+	if(instanceCount)
+	{
+		variant.bindings.push_back(InstanceData::GetBindingDescription());
+		for(const auto &v : InstanceData::GetAttributeDescriptions())
+		{
+			variant.attributes.push_back(v);
+		}
+	}
+	std::vector<PipelineVariant> variants{variant};
 
-	vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, 0, &graphicsPipeline);
+	if(particleCount)
+	{
+		//same state, drawing the particle buffer as points
+		const std::array<VkVertexInputAttributeDescription, 2> particleAttributes = Particle::GetAttributeDescriptions();
+		variant.vertexShader = "particle.vert";
+		variant.fragmentShader = "shader.frag";
+		variant.constants.clear();
+		variant.constantData.clear();
+		variant.bindings.assign(1, Particle::GetBindingDescription());
+		variant.attributes.assign(particleAttributes.begin(), particleAttributes.end());
+		variant.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+		variant.SetConstant(0, particleHotSpeed);
+		variants.push_back(variant);
+	}
 
-	vkDestroyShaderModule(device, vertShaderModule, 0);
-	vkDestroyShaderModule(device, fragShaderModule, 0);
+	//the present pass only reads the scene image, through its own set
+	VkDescriptorSetLayoutBinding sceneBinding = {};
+	sceneBinding.binding = 0;
+	sceneBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	sceneBinding.descriptorCount = 1;
+	sceneBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	layoutInfo.pBindings = &sceneBinding;
+	vkCreateDescriptorSetLayout(device, &layoutInfo, 0, &presentSetLayout);
+
+	VkPipelineLayoutCreateInfo presentLayoutInfo = {};
+	presentLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	presentLayoutInfo.setLayoutCount = 1;
+	presentLayoutInfo.pSetLayouts = &presentSetLayout;
+	vkCreatePipelineLayout(device, &presentLayoutInfo, 0, &presentPipelineLayout);
+
+	//the shader fetches texels, the sampler is only there because the descriptor needs one
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	vkCreateSampler(device, &samplerInfo, 0, &presentSampler);
+
+	//a fullscreen triangle made up from the vertex index, no vertex input
+	PipelineVariant present;
+	present.vertexShader = "present.vert";
+	present.fragmentShader = "present.frag";
+	present.cullMode = VK_CULL_MODE_NONE;
+	present.layout = presentPipelineLayout;
+	present.renderPass = renderGraph.RenderPass(presentPass);
+	variants.push_back(present);
+
+	//nothing waits here, CreateCommandBuffers picks up the main and present pipelines and
+	//the particles are left out of frames until theirs is done
+	const std::vector<PipelineHandle> handles = pipelineBuilder.Submit(variants);
+	graphicsPipelineHandle = handles[0];
+	if(particleCount)
+	{
+		particlePipelineHandle = handles[1];
+	}
+	presentPipelineHandle = handles.back();
 }
 
 
 void Vulkan::CreateFramebuffers()
 {
-	swapchainFramebuffers.resize(swapchainImageViews.size());
-
-	for(int x = 0; x < swapchainImageViews.size(); ++x)
-	{
-		std::array<VkImageView, 1> attachments{swapchainImageViews[x]};
+	renderGraph.SetImportedImages(backbuffer, swapchainImages, swapchainImageViews);
+	renderGraph.CreateTargets(swapchainExtent);
+	CreatePresentSet();
+}
 
-		VkFramebufferCreateInfo framebufferInfo = {};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = 1;
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = swapchainExtent.width;
-		framebufferInfo.height = swapchainExtent.height;
-		framebufferInfo.layers = 1;
 
-		vkCreateFramebuffer(device, &framebufferInfo, 0, &swapchainFramebuffers[x]);
-	}
+void Vulkan::CreatePresentSet()
+{
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	vkCreateDescriptorPool(device, &poolInfo, 0, &presentPool);
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = presentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &presentSetLayout;
+	vkAllocateDescriptorSets(device, &allocInfo, &presentSet);
+
+	//the graph's present pass has it in this layout whenever it samples
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = presentSampler;
+	imageInfo.imageView = renderGraph.View(sceneColor, 0);
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = presentSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, 0);
 }
 
 
 void Vulkan::CreateCommandPool()
 {
-	int index = FindQueueFamily(physicalDevice);
+	if(particleCount && recordMode == RecordMode::Prerecorded)
+	{
+		//the particle buffer drawn changes every frame
+		std::cout << "Particles need per frame recording, switching to it\n";
+		recordMode = RecordMode::PerFrame;
+	}
+	if(!texturePaths.empty() && recordMode == RecordMode::Prerecorded)
+	{
+		//a streamed texture moves from the placeholder's index to its own once its preview is resident
+		std::cout << "Streamed textures need per frame recording, switching to it\n";
+		recordMode = RecordMode::PerFrame;
+	}
 
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = index;
+	poolInfo.queueFamilyIndex = queueFamilies.transfer;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	vkCreateCommandPool(device, &poolInfo, 0, &transferCommandPool);
+
+	poolInfo.queueFamilyIndex = queueFamilies.graphics;
 	poolInfo.flags = 0;
 
 	vkCreateCommandPool(device, &poolInfo, 0, &commandPool);
+
+	if(recordMode != RecordMode::Prerecorded)
+	{
+		if(recordMode == RecordMode::Parallel)
+		{
+			threadPool.Create(workerCount);
+		}
+
+		//everything allocated from these is rerecorded each frame, they're reset as a whole
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		frameCommands.resize(std::max(maxFramesInFlight, 1u));
+		for(auto &v : frameCommands)
+		{
+			vkCreateCommandPool(device, &poolInfo, 0, &v.pool);
+			v.workerPools.resize(threadPool.Size());
+			for(auto &w : v.workerPools)
+			{
+				vkCreateCommandPool(device, &poolInfo, 0, &w);
+			}
+		}
+	}
+
+	if(!tracePath.empty() || measureLatency)
+	{
+		//query slots follow the command buffers
+		profiler.Create(device, physicalDevice, queueFamilies.graphics, RecordingSlotCount());
+	}
+
+	//uniform slots follow them too
+	CreateFrameUniforms(RecordingSlotCount());
+
+	//without descriptor indexing, frames recorded every time get a freshly written copy of the table
+	resourceSet = resourceTable.Set();
+	if(!resourceTable.Bindless() && recordMode != RecordMode::Prerecorded)
+	{
+		const std::vector<VkDescriptorPoolSize> tableSizes
+		{
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, resourceTable.ImageCapacity()},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, resourceTable.BufferCapacity()},
+		};
+		frameDescriptors.Create(device, tableSizes, 4);
+		frameResources.assign(std::max(maxFramesInFlight, 1u), FrameResources());
+	}
+
+	//decoding starts right away, uploads are recorded per frame in flight by DrawFrame
+	if(!texturePaths.empty())
+	{
+		textures.Create(device, physicalDevice, allocator, resourceTable, queueFamilies.graphics, maxFramesInFlight, textureBudget, textureThreads);
+		for(const auto &v : texturePaths)
+		{
+			textureHandles.push_back(textures.Load(v));
+		}
+	}
 }
 
 
-void Vulkan::CreateCommandBuffers()
+void Vulkan::CreateVertexBuffers()
 {
-	commandBuffers.resize(swapchainFramebuffers.size());
+	const VkDeviceSize vertexSize = sizeof(Vertex) * triangleVertices.size();
+	const VkDeviceSize indexSize = sizeof(uint16_t) * triangleIndices.size();
 
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = commandPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = commandBuffers.size();
+	CreateBuffer(vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexAllocation);
+	CreateBuffer(indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexAllocation);
 
-	vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data());
+	QueueUpload(vertexBuffer, 0, triangleVertices.data(), vertexSize);
+	QueueUpload(indexBuffer, 0, triangleIndices.data(), indexSize);
+	indexCount = triangleIndices.size();
 
-	for(int x = 0; x < commandBuffers.size(); ++x)
+	if(instanceCount)
 	{
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		beginInfo.pInheritanceInfo = 0;
-
-		vkBeginCommandBuffer(commandBuffers[x], &beginInfo);
+		const std::vector<InstanceData> instances = CreateStressScene(instanceCount);
+		const VkDeviceSize instanceSize = sizeof(InstanceData) * instances.size();
 
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapchainFramebuffers[x];
-		renderPassInfo.renderArea.offset = {0, 0};
-		renderPassInfo.renderArea.extent = swapchainExtent;
-		VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
-
-		vkCmdBeginRenderPass(commandBuffers[x], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(commandBuffers[x], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-		vkCmdDraw(commandBuffers[x], 3, 1, 0, 0);
-		vkCmdEndRenderPass(commandBuffers[x]);
+		CreateBuffer(instanceSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | (gpuCulling ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0),
+					 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, instanceAllocation);
+		QueueUpload(instanceBuffer, 0, instances.data(), instanceSize);
+	}
 
-		vkEndCommandBuffer(commandBuffers[x]);
+	//one draw per instancesPerDraw instances, so recording cost can be scaled independently of the instance count
+	drawList.clear();
+	const uint32_t totalInstances = std::max(instanceCount, 1u);
+	const uint32_t drawSize = instancesPerDraw ? std::min(instancesPerDraw, totalInstances) : totalInstances;
+	for(uint32_t x = 0; x < totalInstances; x += drawSize)
+	{
+		drawList.push_back({x, std::min(drawSize, totalInstances - x)});
+		if(!textureHandles.empty())
+		{
+			drawList.back().texture = textureHandles[(drawList.size() - 1) % textureHandles.size()];
+		}
 	}
-}
 
+	FlushUploads();
 
-void Vulkan::CreateSemaphores()
-{
-	VkSemaphoreCreateInfo semaphoreInfo = {};
-	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	vkCreateSemaphore(device, &semaphoreInfo, 0, &imageAvailable);
-	vkCreateSemaphore(device, &semaphoreInfo, 0, &renderFinished);
+	if(gpuCulling)
+	{
+		CreateCullPipeline();
+		CreateCullBuffers();
+	}
 }
 
 
-void Vulkan::DrawFrame()
+void Vulkan::CreateParticles()
 {
-	uint32_t imageIndex;
-	vkAcquireNextImageKHR(device, swapchain, 0xFFFFFFFFFFFFFFFF, imageAvailable, VK_NULL_HANDLE, &imageIndex);
+	if(!particleCount)
+	{
+		return;
+	}
 
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	const uint32_t frameCount = std::max(maxFramesInFlight, 1u);
+	const uint32_t bufferCount = frameCount + 1;
 
-	std::array<VkSemaphore, 1> waitSemaphores{imageAvailable};
-	std::array<VkPipelineStageFlags, 1> waitStages{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores.data();
-	submitInfo.pWaitDstStageMask = waitStages.data();
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	//written on the compute queue and read on graphics, concurrent sharing saves the ownership transfers
+	std::vector<uint32_t> families{uint32_t(queueFamilies.graphics)};
+	if(queueFamilies.compute != queueFamilies.graphics)
+	{
+		families.push_back(queueFamilies.compute);
+	}
 
-	std::array<VkSemaphore, 1> signalSemaphores{renderFinished};
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores.data();
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = VkDeviceSize(sizeof(Particle)) * particleCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	bufferInfo.sharingMode = families.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	bufferInfo.queueFamilyIndexCount = families.size() > 1 ? families.size() : 0;
+	bufferInfo.pQueueFamilyIndices = families.data();
+
+	particleBuffers.resize(bufferCount);
+	particleAllocations.resize(bufferCount);
+	for(uint32_t x = 0; x < bufferCount; ++x)
+	{
+		allocator.CreateBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationStrategy::FreeList, particleBuffers[x], particleAllocations[x]);
+	}
 
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+	for(uint32_t x = 0; x < bindings.size(); ++x)
+	{
+		bindings[x].binding = x;
+		bindings[x].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[x].descriptorCount = 1;
+		bindings[x].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
 
-	VkPresentInfoKHR presentInfo = {};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores.data();
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = bindings.size();
+	layoutInfo.pBindings = bindings.data();
+	vkCreateDescriptorSetLayout(device, &layoutInfo, 0, &particleSetLayout);
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = bufferCount * 2;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = bufferCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	vkCreateDescriptorPool(device, &poolInfo, 0, &particleDescriptorPool);
+
+	const std::vector<VkDescriptorSetLayout> setLayouts(bufferCount, particleSetLayout);
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = particleDescriptorPool;
+	setInfo.descriptorSetCount = bufferCount;
+	setInfo.pSetLayouts = setLayouts.data();
+	particleDescriptorSets.resize(bufferCount);
+	vkAllocateDescriptorSets(device, &setInfo, particleDescriptorSets.data());
+
+	for(uint32_t x = 0; x < bufferCount; ++x)
+	{
+		const std::array<VkDescriptorBufferInfo, 2> buffers
+		{{
+			{particleBuffers[(x + bufferCount - 1) % bufferCount], 0, VK_WHOLE_SIZE},
+			{particleBuffers[x], 0, VK_WHOLE_SIZE},
+		}};
+
+		std::array<VkWriteDescriptorSet, 2> writes = {};
+		for(uint32_t y = 0; y < writes.size(); ++y)
+		{
+			writes[y].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[y].dstSet = particleDescriptorSets[x];
+			writes[y].dstBinding = y;
+			writes[y].descriptorCount = 1;
+			writes[y].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[y].pBufferInfo = &buffers[y];
+		}
+		vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, 0);
+	}
 
-	std::array<VkSwapchainKHR, 1> swapchains{swapchain};
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapchains.data();
-	presentInfo.pImageIndices = &imageIndex;
+	//dt, count, reset
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = 3 * sizeof(uint32_t);
 
-	vkQueuePresentKHR(presentQueue, &presentInfo);
-}
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &particleSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	vkCreatePipelineLayout(device, &pipelineLayoutInfo, 0, &computePipelineLayout);
+
+	VkShaderModule computeShaderModule;
+	CreateShaderModule("particles.comp", computeShaderModule);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = computeShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = computePipelineLayout;
+	vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, 0, &computePipeline);
+	vkDestroyShaderModule(device, computeShaderModule, 0);
+
+	//recorded every frame, like the graphics work
+	VkCommandPoolCreateInfo commandPoolInfo = {};
+	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolInfo.queueFamilyIndex = queueFamilies.compute;
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
 
-void Vulkan::PrintAvailableExtensions()
-{
-	uint32_t availableExtensionCount;
-	vkEnumerateInstanceExtensionProperties(0, &availableExtensionCount, 0);
-	std::vector<VkExtensionProperties> availableExtensions(availableExtensionCount);
-	vkEnumerateInstanceExtensionProperties(0, &availableExtensionCount, availableExtensions.data());
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	std::cout << "Available extensions:\n";
-	for(const auto &v : availableExtensions)
+	computePools.resize(frameCount);
+	computeCommandBuffers.resize(frameCount);
+	computeFinishedSemaphores.resize(frameCount);
+	for(uint32_t x = 0; x < frameCount; ++x)
 	{
-		std::cout << "  " << v.extensionName << "\n";
+		vkCreateCommandPool(device, &commandPoolInfo, 0, &computePools[x]);
+		allocInfo.commandPool = computePools[x];
+		vkAllocateCommandBuffers(device, &allocInfo, &computeCommandBuffers[x]);
+		vkCreateSemaphore(device, &semaphoreInfo, 0, &computeFinishedSemaphores[x]);
 	}
-	std::cout << "\n";
 }
 
 
-void Vulkan::Destroy()
+void Vulkan::CreateCommandBuffers()
 {
-	vkDeviceWaitIdle(device);
+	//the first point anything is recorded, so pipeline compilation overlaps the buffer set up before it
+	if(!graphicsPipeline)
+	{
+		ProfileScope scope(profiler, "wait for pipeline");
+		graphicsPipeline = PipelineBuilder::Get(graphicsPipelineHandle);
+		presentPipeline = PipelineBuilder::Get(presentPipelineHandle);
+	}
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
 
-	if(enableValidationLayers)
+	if(recordMode != RecordMode::Prerecorded)
 	{
-		PFN_vkDestroyDebugReportCallbackEXT vkDestroyDebugReportCallbackEXT = PFN_vkDestroyDebugReportCallbackEXT(glfwGetInstanceProcAddress(instance, "vkDestroyDebugReportCallbackEXT"));
-		if(vkDestroyDebugReportCallbackEXT)
-		{
-			vkDestroyDebugReportCallbackEXT(instance, callback, 0);
-		}
-		else
+		//recorded in DrawFrame
+		for(auto &v : frameCommands)
 		{
-			std::cout << "Loading vkDestroyDebugReportCallbackEXT failed!\n";
+			allocInfo.commandPool = v.pool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			vkAllocateCommandBuffers(device, &allocInfo, &v.primary);
+
+			v.secondaries.resize(v.workerPools.size());
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			for(uint32_t x = 0; x < v.workerPools.size(); ++x)
+			{
+				allocInfo.commandPool = v.workerPools[x];
+				vkAllocateCommandBuffers(device, &allocInfo, &v.secondaries[x]);
+			}
 		}
+		return;
 	}
 
-	if(imageAvailable)
-	{
-		vkDestroySemaphore(device, imageAvailable, 0);
-	}
-	if(renderFinished)
+	commandBuffers.resize(swapchainImages.size());
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = commandBuffers.size();
+
+	vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data());
+
+	//without descriptor indexing the table's own set is baked into the buffers. it's only written
+	//while nothing can be pending, here the first time and by SetDrawList
+	if(!resourceTable.Bindless() && !tableSetWritten)
 	{
-		vkDestroySemaphore(device, renderFinished, 0);
+		resourceTable.Write(resourceTable.Set());
+		tableSetWritten = true;
 	}
-	if(commandPool)
+	RecordPrerecorded();
+}
+
+
+void Vulkan::SetDrawList(const std::vector<DrawCommand> &draws)
+{
+	drawList = draws;
+	if(gpuCulling)
 	{
-		vkDestroyCommandPool(device, commandPool, 0);
+		CreateCullBuffers();
 	}
-	for(auto &v : swapchainFramebuffers)
+
+	if(recordMode == RecordMode::Prerecorded && !commandBuffers.empty())
 	{
-		if(v)
+		//the draws are baked into every image's buffer, none of them may be pending while they're rerecorded
+		vkDeviceWaitIdle(device);
+		for(auto &v : imagesInFlight)
 		{
-			vkDestroyFramebuffer(device, v, 0);
+			v = VK_NULL_HANDLE;
 		}
+		vkFreeCommandBuffers(device, commandPool, commandBuffers.size(), commandBuffers.data());
+		commandBuffers.clear();
+		tableSetWritten = false;
+		CreateCommandBuffers();
 	}
-	if(graphicsPipeline)
+}
+
+
+void Vulkan::UpdateResourceSet()
+{
+	//a frame allocates its copy the first time it runs and keeps it for good. once its fence has
+	//signalled, only the entries changed since it last ran are written, a streamed texture costs
+	//one descriptor per frame in flight
+	FrameResources &resources = frameResources[currentFrame];
+	if(!resources.set)
 	{
-		vkDestroyPipeline(device, graphicsPipeline, 0);
+		resources.set = frameDescriptors.Allocate(resourceTable.Layout());
+		if(resources.set)
+		{
+			resourceTable.Write(resources.set);
+		}
 	}
-	if(renderPass)
+	else if(resources.version != resourceTable.Version())
 	{
-		vkDestroyRenderPass(device, renderPass, 0);
+		resourceTable.Update(resources.set, resources.version);
 	}
+	resources.version = resourceTable.Version();
+	resourceSet = resources.set;
+}
+
+
+void Vulkan::RecordPrerecorded()
+{
+	for(int x = 0; x < commandBuffers.size(); ++x)
+	{
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = 0; //imagesInFlight keeps a buffer from being resubmitted while pending
+		beginInfo.pInheritanceInfo = 0;
+
+		vkBeginCommandBuffer(commandBuffers[x], &beginInfo);
+		profiler.CmdBeginFrame(commandBuffers[x], x);
+		RecordCull(commandBuffers[x], x);
+
+		const uint32_t zone = profiler.CmdBeginZone(commandBuffers[x], x, "render pass");
+		renderGraph.CmdBeginPass(commandBuffers[x], scenePass, x, VK_SUBPASS_CONTENTS_INLINE);
+		RecordDraws(commandBuffers[x], x, 0, drawList.size());
+		renderGraph.CmdEndPass(commandBuffers[x], scenePass, x);
+		profiler.CmdEndZone(commandBuffers[x], x, zone);
+		RecordPresent(commandBuffers[x], x, x);
+
+		vkEndCommandBuffer(commandBuffers[x]);
+	}
+}
+
+
+void Vulkan::CreateSemaphores()
+{
+	if(!maxFramesInFlight)
+	{
+		maxFramesInFlight = 1;
+	}
+
+	imageAvailableSemaphores.resize(maxFramesInFlight);
+	renderFinishedSemaphores.resize(maxFramesInFlight);
+	inFlightFences.resize(maxFramesInFlight);
+	imagesInFlight.resize(swapchainImages.size(), VK_NULL_HANDLE);
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; //first wait on each frame returns immediately
+
+	for(uint32_t x = 0; x < maxFramesInFlight; ++x)
+	{
+		vkCreateSemaphore(device, &semaphoreInfo, 0, &imageAvailableSemaphores[x]);
+		vkCreateSemaphore(device, &semaphoreInfo, 0, &renderFinishedSemaphores[x]);
+		vkCreateFence(device, &fenceInfo, 0, &inFlightFences[x]);
+	}
+}
+
+
+bool Vulkan::RecreateSwapchain()
+{
+	if(headless)
+	{
+		framebufferResized = false;
+		return true;
+	}
+
+	//minimised, keep the current swapchain until there's something to draw to
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	if(!width || !height)
+	{
+		return false;
+	}
+	framebufferResized = false;
+
+	//frames in flight may still use any of these, retire them instead of waiting idle
+	const VkSwapchainKHR oldSwapchain = swapchain;
+	const VkDescriptorPool oldPresentPool = presentPool;
+	std::vector<VkImageView> oldImageViews;
+	RenderGraph::Targets oldTargets = renderGraph.TakeTargets();
+	std::vector<VkCommandBuffer> oldCommandBuffers;
+	oldImageViews.swap(swapchainImageViews);
+	oldCommandBuffers.swap(commandBuffers);
+
+	CreateSwapchain();
+	CreateImageViews();
+	CreateFramebuffers();
+
+	//prerecorded buffers use one uniform slot per image, more images need a bigger ring
+	if(recordMode == RecordMode::Prerecorded && swapchainImages.size() > frameUniforms.ring.SlotCount())
+	{
+		//on failure the old ring stays, images past its slots just get no frame data
+		FrameUniforms oldUniforms = frameUniforms;
+		frameUniforms = {};
+		if(CreateFrameUniforms(swapchainImages.size()))
+		{
+			DeferDestroy([this, oldUniforms]() mutable
+			{
+				oldUniforms.ring.Destroy(allocator);
+				vkDestroyDescriptorPool(device, oldUniforms.pool, 0);
+			});
+		}
+		else
+		{
+			frameUniforms = oldUniforms;
+		}
+	}
+	if(gpuCulling && RecordingSlotCount() > cull.commands.size())
+	{
+		CreateCullBuffers();
+	}
+	if(recordMode == RecordMode::Prerecorded)
+	{
+		CreateCommandBuffers();
+	}
+	imagesInFlight.assign(swapchainImages.size(), VK_NULL_HANDLE);
+
+	DeferDestroy([=]() mutable
+	{
+		if(!oldCommandBuffers.empty())
+		{
+			vkFreeCommandBuffers(device, commandPool, oldCommandBuffers.size(), oldCommandBuffers.data());
+		}
+		renderGraph.DestroyTargets(oldTargets);
+		vkDestroyDescriptorPool(device, oldPresentPool, 0);
+		for(auto &v : oldImageViews)
+		{
+			vkDestroyImageView(device, v, 0);
+		}
+		vkDestroySwapchainKHR(device, oldSwapchain, 0);
+	});
+
+	if(verbose)
+	{
+		std::cout << "Swapchain recreated at " << swapchainExtent.width << "x" << swapchainExtent.height << "\n";
+	}
+	return true;
+}
+
+
+void Vulkan::DrawFrame()
+{
+	if(!inputSampled)
+	{
+		inputTime = Profiler::Clock::now();
+	}
+	inputSampled = false;
+
+	{
+		//caps the queue at maxFramesInFlight frames
+		ProfileScope scope(profiler, "vkWaitForFences");
+		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, 0xFFFFFFFFFFFFFFFF);
+	}
+	RunDeferredDestroys(false);
+
+	if(framebufferResized && !RecreateSwapchain())
+	{
+		return;
+	}
+
+	uint32_t imageIndex = currentFrame;
+	if(!headless)
+	{
+		ProfileScope scope(profiler, "vkAcquireNextImageKHR");
+		VkResult result = vkAcquireNextImageKHR(device, swapchain, 0xFFFFFFFFFFFFFFFF, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		if(result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			//nothing was acquired or submitted, the fence is still signalled for the next try
+			framebufferResized = true;
+			return;
+		}
+		else if(result == VK_SUBOPTIMAL_KHR)
+		{
+			//the semaphore will still be signalled, draw this one and recreate afterwards
+			framebufferResized = true;
+		}
+	}
+
+	//this frame's share of the texture uploads, only once the frame is sure to be submitted.
+	//views whose previews have landed are added to the table, the frame's copy picks them up
+	VkCommandBuffer textureCommands;
+	{
+		ProfileScope scope(profiler, "texture uploads");
+		textureCommands = textures.Update(currentFrame);
+	}
+	if(!frameResources.empty())
+	{
+		UpdateResourceSet();
+	}
+
+	//images can come back out of order, wait on whichever frame still uses this one
+	if(imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+	{
+		vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, 0xFFFFFFFFFFFFFFFF);
+	}
+	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+	//prerecorded buffers belong to an image, per frame recordings to the frame in flight
+	const uint32_t slot = recordMode == RecordMode::Prerecorded ? imageIndex : currentFrame;
+	profiler.Collect(slot);
+
+	int64_t gpuEnd;
+	if(measureLatency && slot < slotInputTimes.size() && profiler.GetGpuEnd(slot, gpuEnd) && latency.inputToGpuEnd.size() < profiler.maxEvents)
+	{
+		latency.inputToGpuEnd.push_back((gpuEnd - profiler.ToTime(slotInputTimes[slot])) / 1e6);
+	}
+	slotInputTimes.resize(std::max<size_t>(slotInputTimes.size(), slot + 1));
+	slotInputTimes[slot] = inputTime;
+	allocator.BeginFrame(currentFrame);
+
+	//lands at the slot's start, where every recorded bind points
+	if(!frameNumber)
+	{
+		firstFrameTime = inputTime;
+	}
+	frameData.time = std::chrono::duration<float>(inputTime - firstFrameTime).count();
+	frameUniforms.ring.BeginSlot(slot);
+	uint32_t frameOffset;
+	if(FrameData* mapped = frameUniforms.ring.Allocate<FrameData>(frameOffset))
+	{
+		*mapped = frameData;
+	}
+
+	if(particleCount)
+	{
+		SubmitCompute();
+	}
+
+	VkCommandBuffer commandBuffer = commandBuffers.empty() ? 0 : commandBuffers[imageIndex];
+	if(recordMode != RecordMode::Prerecorded)
+	{
+		ProfileScope scope(profiler, "record");
+		RecordFrame(currentFrame, imageIndex);
+		commandBuffer = frameCommands[currentFrame].primary;
+	}
+
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<VkPipelineStageFlags> waitStages;
+	std::vector<VkCommandBuffer> submitBuffers;
+	if(!headless)
+	{
+		waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+		waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	}
+
+	//ownership of finished uploads is acquired ahead of the frame's own commands
+	RetireUploads(false);
+	for(const auto &v : pendingAcquires)
+	{
+		waitSemaphores.push_back(v.semaphore);
+		waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		submitBuffers.push_back(v.commandBuffer);
+	}
+	if(particleCount)
+	{
+		waitSemaphores.push_back(computeFinishedSemaphores[currentFrame]);
+		waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	}
+	if(textureCommands)
+	{
+		submitBuffers.push_back(textureCommands);
+	}
+	submitBuffers.push_back(commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = waitSemaphores.size();
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = submitBuffers.size();
+	submitInfo.pCommandBuffers = submitBuffers.data();
+
+	//nothing to present when headless
+	std::array<VkSemaphore, 1> signalSemaphores{renderFinishedSemaphores[currentFrame]};
+	submitInfo.signalSemaphoreCount = headless ? 0 : 1;
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	profiler.MarkSubmit(slot);
+	{
+		ProfileScope scope(profiler, "vkQueueSubmit");
+		vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]);
+	}
+
+	if(!pendingAcquires.empty())
+	{
+		const std::vector<PendingAcquire> acquires = std::move(pendingAcquires);
+		pendingAcquires.clear();
+		DeferDestroy([=]()
+		{
+			for(const auto &v : acquires)
+			{
+				vkFreeCommandBuffers(device, commandPool, 1, &v.commandBuffer);
+				vkDestroySemaphore(device, v.semaphore, 0);
+			}
+		});
+	}
+
+	if(!headless)
+	{
+		VkPresentInfoKHR presentInfo = {};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = signalSemaphores.data();
+
+		std::array<VkSwapchainKHR, 1> swapchains{swapchain};
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = swapchains.data();
+		presentInfo.pImageIndices = &imageIndex;
+
+		ProfileScope scope(profiler, "vkQueuePresentKHR");
+		VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+		if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		{
+			framebufferResized = true;
+		}
+	}
+
+	if(measureLatency && latency.inputToPresent.size() < profiler.maxEvents)
+	{
+		latency.inputToPresent.push_back(std::chrono::duration<double, std::milli>(Profiler::Clock::now() - inputTime).count());
+	}
+
+	++frameNumber;
+	profiler.NextFrame();
+	currentFrame = (currentFrame + 1) % maxFramesInFlight;
+}
+
+
+void Vulkan::SampleInput()
+{
+	inputTime = Profiler::Clock::now();
+	inputSampled = true;
+}
+
+
+const char* Vulkan::GetPresentModeName() const
+{
+	if(headless)
+	{
+		return "none";
+	}
+
+	const std::array<const char*, 4> names{"immediate", "mailbox", "fifo", "fifo_relaxed"};
+	return presentMode < names.size() ? names[presentMode] : "unknown";
+}
+
+
+bool ParsePresentPolicy(const std::string &name, PresentPolicy &policy)
+{
+	if(name == "vsync")
+	{
+		policy = PresentPolicy::Vsync;
+	}
+	else if(name == "throughput")
+	{
+		policy = PresentPolicy::Throughput;
+	}
+	else if(name == "low-latency")
+	{
+		policy = PresentPolicy::LowLatency;
+	}
+	else if(name == "adaptive")
+	{
+		policy = PresentPolicy::Adaptive;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+
+bool Vulkan::ParseOption(int argc, char* argv[], int &x)
+{
+	const std::string arg = argv[x];
+	if(arg == "--device" && x + 1 < argc)
+	{
+		deviceOverride = argv[++x];
+	}
+	else if(arg == "--frames-in-flight" && x + 1 < argc)
+	{
+		maxFramesInFlight = std::strtoul(argv[++x], 0, 10);
+	}
+	else if(arg == "--instances" && x + 1 < argc)
+	{
+		instanceCount = std::strtoul(argv[++x], 0, 10);
+	}
+	else if(arg == "--draw-size" && x + 1 < argc)
+	{
+		instancesPerDraw = std::strtoul(argv[++x], 0, 10);
+	}
+	else if(arg == "--present" && x + 1 < argc && ParsePresentPolicy(argv[x + 1], presentPolicy))
+	{
+		++x;
+	}
+	else if(arg == "--images" && x + 1 < argc)
+	{
+		swapchainImageCount = std::strtoul(argv[++x], 0, 10);
+	}
+	else if(arg == "--latency")
+	{
+		measureLatency = true;
+	}
+	else if(arg == "--particles" && x + 1 < argc)
+	{
+		particleCount = std::strtoul(argv[++x], 0, 10);
+	}
+	else if(arg == "--gpu-cull")
+	{
+		gpuCulling = true;
+	}
+	else if(arg == "--per-frame")
+	{
+		recordMode = RecordMode::PerFrame;
+	}
+	else if(arg == "--parallel")
+	{
+		recordMode = RecordMode::Parallel;
+	}
+	else if(arg == "--threads" && x + 1 < argc)
+	{
+		workerCount = std::strtoul(argv[++x], 0, 10);
+	}
+	else if(arg == "--bindless")
+	{
+		bindless = true;
+	}
+	else if(arg == "--texture" && x + 1 < argc)
+	{
+		texturePaths.push_back(argv[++x]);
+	}
+	else if(arg == "--texture-budget" && x + 1 < argc)
+	{
+		textureBudget = VkDeviceSize(std::strtoul(argv[++x], 0, 10)) << 10;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+
+const char* Vulkan::OptionUsage()
+{
+	return "[--device index|name] [--frames-in-flight n] [--instances n] [--draw-size n] [--present vsync|throughput|low-latency|adaptive] "
+		   "[--images n] [--latency] [--particles n] [--gpu-cull] [--per-frame] [--parallel] [--threads n] [--bindless] "
+		   "[--texture file.ppm|tga]... [--texture-budget KiB]";
+}
+
+
+std::string Vulkan::GetDeviceName()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	return properties.deviceName;
+}
+
+
+void Vulkan::WaitIdle()
+{
+	vkDeviceWaitIdle(device);
+}
+
+
+void Vulkan::PrintAvailableExtensions()
+{
+	uint32_t availableExtensionCount;
+	vkEnumerateInstanceExtensionProperties(0, &availableExtensionCount, 0);
+	std::vector<VkExtensionProperties> availableExtensions(availableExtensionCount);
+	vkEnumerateInstanceExtensionProperties(0, &availableExtensionCount, availableExtensions.data());
+
+	std::cout << "Available extensions:\n";
+	for(const auto &v : availableExtensions)
+	{
+		std::cout << "  " << v.extensionName << "\n";
+	}
+	std::cout << "\n";
+}
+
+
+void Vulkan::Destroy()
+{
+	vkDeviceWaitIdle(device);
+	RunDeferredDestroys(true);
+	RetireUploads(true);
+	for(const auto &v : pendingAcquires)
+	{
+		vkDestroySemaphore(device, v.semaphore, 0);
+	}
+
+	if(profiler.enabled)
+	{
+		for(uint32_t x = 0; x < RecordingSlotCount(); ++x)
+		{
+			profiler.Collect(x);
+		}
+		if(!tracePath.empty())
+		{
+			profiler.WriteTrace(tracePath);
+		}
+		profiler.Destroy();
+	}
+
+	//owns graphicsPipeline, particlePipeline and presentPipeline, and has to finish before the cache is saved
+	pipelineBuilder.Destroy();
+
+	if(pipelineCache)
+	{
+		SavePipelineCache();
+		vkDestroyPipelineCache(device, pipelineCache, 0);
+	}
+
+	if(validation)
+	{
+		PFN_vkDestroyDebugReportCallbackEXT vkDestroyDebugReportCallbackEXT = PFN_vkDestroyDebugReportCallbackEXT(vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT"));
+		if(vkDestroyDebugReportCallbackEXT)
+		{
+			vkDestroyDebugReportCallbackEXT(instance, callback, 0);
+		}
+		else
+		{
+			std::cout << "Loading vkDestroyDebugReportCallbackEXT failed!\n";
+		}
+	}
+
+	for(auto &v : imageAvailableSemaphores)
+	{
+		if(v)
+		{
+			vkDestroySemaphore(device, v, 0);
+		}
+	}
+	for(auto &v : renderFinishedSemaphores)
+	{
+		if(v)
+		{
+			vkDestroySemaphore(device, v, 0);
+		}
+	}
+	for(auto &v : inFlightFences)
+	{
+		if(v)
+		{
+			vkDestroyFence(device, v, 0);
+		}
+	}
+	if(commandPool)
+	{
+		vkDestroyCommandPool(device, commandPool, 0);
+	}
+	if(transferCommandPool)
+	{
+		vkDestroyCommandPool(device, transferCommandPool, 0);
+	}
+	threadPool.Destroy();
+	for(auto &v : frameCommands)
+	{
+		for(auto &w : v.workerPools)
+		{
+			vkDestroyCommandPool(device, w, 0);
+		}
+		vkDestroyCommandPool(device, v.pool, 0);
+	}
+	textures.Destroy();
+	frameDescriptors.Destroy();
+	resourceTable.Destroy();
+	frameUniforms.ring.Destroy(allocator);
+	if(frameUniforms.pool)
+	{
+		vkDestroyDescriptorPool(device, frameUniforms.pool, 0);
+	}
+	if(frameSetLayout)
+	{
+		vkDestroyDescriptorSetLayout(device, frameSetLayout, 0);
+	}
+	allocator.DestroyBuffer(vertexBuffer, vertexAllocation);
+	allocator.DestroyBuffer(indexBuffer, indexAllocation);
+	allocator.DestroyBuffer(instanceBuffer, instanceAllocation);
+	for(uint32_t x = 0; x < particleBuffers.size(); ++x)
+	{
+		allocator.DestroyBuffer(particleBuffers[x], particleAllocations[x]);
+	}
+	for(uint32_t x = 0; x < computePools.size(); ++x)
+	{
+		vkDestroyCommandPool(device, computePools[x], 0);
+		vkDestroySemaphore(device, computeFinishedSemaphores[x], 0);
+	}
+	if(computePipeline)
+	{
+		vkDestroyPipeline(device, computePipeline, 0);
+		vkDestroyPipelineLayout(device, computePipelineLayout, 0);
+		vkDestroyDescriptorPool(device, particleDescriptorPool, 0);
+		vkDestroyDescriptorSetLayout(device, particleSetLayout, 0);
+	}
+	cull.Destroy(device, allocator);
+	if(cullPipeline)
+	{
+		vkDestroyPipeline(device, cullPipeline, 0);
+		vkDestroyPipelineLayout(device, cullPipelineLayout, 0);
+		vkDestroyDescriptorSetLayout(device, cullSetLayout, 0);
+	}
+	renderGraph.Destroy();
 	if(pipelineLayout)
 	{
-		vkDestroyPipelineLayout(device, pipelineLayout, 0);
+		vkDestroyPipelineLayout(device, pipelineLayout, 0);
+	}
+	if(presentPool)
+	{
+		vkDestroyDescriptorPool(device, presentPool, 0);
+	}
+	if(presentPipelineLayout)
+	{
+		vkDestroyPipelineLayout(device, presentPipelineLayout, 0);
+		vkDestroyDescriptorSetLayout(device, presentSetLayout, 0);
+		vkDestroySampler(device, presentSampler, 0);
+	}
+	for(auto &v : swapchainImageViews)
+	{
+		if(v)
+		{
+			vkDestroyImageView(device, v, 0);
+		}
+	}
+	if(swapchain)
+	{
+		vkDestroySwapchainKHR(device, swapchain, 0);
+	}
+	if(headless)
+	{
+		for(uint32_t x = 0; x < offscreenImageAllocations.size(); ++x)
+		{
+			allocator.DestroyImage(swapchainImages[x], offscreenImageAllocations[x]);
+		}
+	}
+	if(device)
+	{
+		if(verbose)
+		{
+			allocator.PrintStats();
+		}
+		allocator.Destroy();
+	}
+	if(surface)
+	{
+		vkDestroySurfaceKHR(instance, surface, 0);
+	}
+	if(device)
+	{
+		vkDestroyDevice(device, 0);
+	}
+	if(instance)
+	{
+		vkDestroyInstance(instance, 0);
+	}
+}
+
+
+std::vector<const char*> Vulkan::GetRequiredExtensions()
+{
+	std::vector<const char*> extensions;
+
+	if(!headless)
+	{
+		uint32_t glfwExtensionCount;
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+		for(uint32_t x = 0; x < glfwExtensionCount; ++x)
+		{
+			extensions.push_back(glfwExtensions[x]);
+		}
+	}
+
+	if(validation)
+	{
+		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+	}
+
+	//vkGetPhysicalDeviceFeatures2KHR, to see if the device has descriptor indexing
+	if(bindless)
+	{
+		uint32_t availableExtensionCount;
+		vkEnumerateInstanceExtensionProperties(0, &availableExtensionCount, 0);
+		std::vector<VkExtensionProperties> availableExtensions(availableExtensionCount);
+		vkEnumerateInstanceExtensionProperties(0, &availableExtensionCount, availableExtensions.data());
+
+		for(const auto &v : availableExtensions)
+		{
+			if(std::string(v.extensionName) == VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+			{
+				extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+				physicalDeviceProperties2 = true;
+			}
+		}
+	}
+
+	return extensions;
+}
+
+
+bool Vulkan::IsDeviceSuitable(VkPhysicalDevice physDevice)
+{
+	// for(const auto &v : devices)
+	// {
+		// VkPhysicalDeviceProperties deviceProperties;
+		// vkGetPhysicalDeviceProperties(v, &deviceProperties);
+		// VkPhysicalDeviceFeatures deviceFeatures;
+		// vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+
+		// if(deviceFeatures.geometryShader)
+		// {
+			// std::cout << "suitability test";
+		// }
+	// }
+
+	const bool queuesComplete = FindQueueFamilies(physDevice).IsComplete(headless);
+	if(headless)
+	{
+		return queuesComplete;
+	}
+
+	bool extensionsSupported = CheckDeviceExtensionSupport(physDevice, deviceExtensions);
+	bool swapchainGood = false;
+	if(extensionsSupported)
+	{
+		SwapchainSupportDetails swapchainSupport = QuerySwapchainSupport(physDevice);
+		swapchainGood = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
+	}
+
+	return queuesComplete && extensionsSupported && swapchainGood;
+}
+
+
+//0 when unusable. device type dominates so a software rasterizer never beats hardware,
+//then device local memory, then dedicated queues and limits break ties
+uint64_t Vulkan::ScoreDevice(VkPhysicalDevice physDevice)
+{
+	if(!IsDeviceSuitable(physDevice))
+	{
+		return 0;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physDevice, &properties);
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(physDevice, &memProperties);
+
+	uint64_t typeRank = 0;
+	switch(properties.deviceType)
+	{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: typeRank = 4; break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeRank = 3; break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: typeRank = 2; break;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU: typeRank = 1; break;
+		default: break;
+	}
+
+	VkDeviceSize deviceLocal = 0;
+	for(uint32_t x = 0; x < memProperties.memoryHeapCount; ++x)
+	{
+		if(memProperties.memoryHeaps[x].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			deviceLocal += memProperties.memoryHeaps[x].size;
+		}
+	}
+
+	const QueueFamilyIndices indices = FindQueueFamilies(physDevice);
+	uint64_t score = 1 + (typeRank << 48);
+	score += std::min<uint64_t>(deviceLocal >> 20, 0xFFFFFF) << 16; //MiB
+	score += (indices.compute != indices.graphics ? 1 : 0) << 12;
+	score += (indices.transfer != indices.graphics ? 1 : 0) << 11;
+	score += std::min<uint64_t>(properties.limits.maxImageDimension2D >> 10, 0x7FF);
+
+	return score;
+}
+
+
+bool Vulkan::CheckDeviceExtensionSupport(VkPhysicalDevice physDevice, const std::vector<const char*> &extensions)
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physDevice, 0, &extensionCount, 0);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physDevice, 0, &extensionCount, availableExtensions.data());
+
+	bool extensionSupport = true;
+	for(const auto &v : extensions)
+	{
+		bool extensionFound = false;
+		for(const auto &w : availableExtensions)
+		{
+			if(std::string(v) == std::string(w.extensionName))
+			{
+				extensionFound = true;
+				break;
+			}
+		}
+		if(extensionFound == false)
+		{
+			extensionSupport = false;
+			break;
+		}
+	}
+
+	return extensionSupport;
+}
+
+
+bool Vulkan::CheckBindlessSupport(VkPhysicalDevice physDevice)
+{
+	const std::vector<const char*> extensions{VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME};
+	if(!physicalDeviceProperties2 || !CheckDeviceExtensionSupport(physDevice, extensions))
+	{
+		return false;
+	}
+
+	PFN_vkGetPhysicalDeviceFeatures2KHR vkGetPhysicalDeviceFeatures2KHR = PFN_vkGetPhysicalDeviceFeatures2KHR(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if(!vkGetPhysicalDeviceFeatures2KHR)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+	VkPhysicalDeviceFeatures2KHR features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features.pNext = &indexingFeatures;
+	vkGetPhysicalDeviceFeatures2KHR(physDevice, &features);
+
+	return indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound
+		&& indexingFeatures.descriptorBindingUpdateUnusedWhilePending
+		&& indexingFeatures.descriptorBindingSampledImageUpdateAfterBind && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind
+		&& indexingFeatures.shaderSampledImageArrayNonUniformIndexing && indexingFeatures.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+
+bool Vulkan::CheckValidationLayerSupport()
+{
+	uint32_t layerCount;
+	vkEnumerateInstanceLayerProperties(&layerCount, 0);
+
+	std::vector<VkLayerProperties> availableLayers(layerCount);
+	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+	for(const auto &v : availableLayers)
+	{
+		if(std::string(v.layerName) == std::string(validationLayers[0]))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+SwapchainSupportDetails Vulkan::QuerySwapchainSupport(VkPhysicalDevice physDevice)
+{
+	SwapchainSupportDetails details;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physDevice, surface, &details.capabilities);
+
+	uint32_t formatCount;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physDevice, surface, &formatCount, 0);
+	if(formatCount)
+	{
+		details.formats.resize(formatCount);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(physDevice, surface, &formatCount, details.formats.data());
+	}
+
+	uint32_t presentModeCount;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physDevice, surface, &presentModeCount, 0);
+	if(presentModeCount)
+	{
+		details.presentModes.resize(presentModeCount);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(physDevice, surface, &presentModeCount, details.presentModes.data());
+	}
+
+	return details;
+}
+
+
+VkSurfaceFormatKHR Vulkan::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats)
+{
+	if(verbose)
+	{
+		std::cout << "Available formats:\n";
+		for(const auto &v : availableFormats)
+		{
+			std::cout << "  Format: " << v.format << " Colorspace: " << v.colorSpace << "\n";
+		}
+	}
+
+	for(const auto &v : availableFormats)
+	{
+		if(v.format == VK_FORMAT_B8G8R8A8_UNORM && v.colorSpace == false)
+		{
+			return v;
+		}
+	}
+
+	std::cout << "i don't know what format this is... format:"
+			  << availableFormats[0].format << " colorspace:" << availableFormats[0].colorSpace << "\n";
+	return availableFormats[0];	
+}
+
+
+VkPresentModeKHR Vulkan::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes)
+{
+	if(verbose)
+	{
+		const std::array<std::string, 4> presentModeNames
+		{
+			"VK_PRESENT_MODE_IMMEDIATE_KHR", "VK_PRESENT_MODE_MAILBOX_KHR",
+			"VK_PRESENT_MODE_FIFO_KHR", "VK_PRESENT_MODE_FIFO_RELAXED_KHR"
+		};
+		std::cout << "presentation engine modes:\n";
+		for(const auto &v : availablePresentModes)
+		{
+			std::cout << "  " << presentModeNames[v] << "\n";
+		}
+	}
+
+	std::vector<VkPresentModeKHR> preferred;
+	switch(presentPolicy)
+	{
+		case PresentPolicy::Throughput: preferred = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}; break;
+		case PresentPolicy::LowLatency: preferred = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR}; break;
+		case PresentPolicy::Adaptive: preferred = {VK_PRESENT_MODE_FIFO_RELAXED_KHR}; break;
+		case PresentPolicy::Vsync: break;
+	}
+
+	for(const auto &v : preferred)
+	{
+		if(std::find(availablePresentModes.begin(), availablePresentModes.end(), v) != availablePresentModes.end())
+		{
+			return v;
+		}
+	}
+
+	//the only mode every implementation has to support
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+
+VkExtent2D Vulkan::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities)
+{
+	// std::cout << capabilities.currentExtent.width << " " << capabilities.currentExtent.height << "\n";
+	// std::cout << capabilities.maxImageExtent.width << " " << capabilities.maxImageExtent.height << "\n";
+	if(capabilities.currentExtent.width != 0xFFFFFFFF)
+	{
+		return capabilities.currentExtent;
+	}
+	else
+	{
+		int width = 800, height = 600;
+		if(window)
+		{
+			glfwGetFramebufferSize(window, &width, &height);
+		}
+		VkExtent2D extent = {uint32_t(width), uint32_t(height)};
+		extent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, extent.width));
+		extent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, extent.height));
+		return extent;
+	}
+}
+
+QueueFamilyIndices Vulkan::FindQueueFamilies(VkPhysicalDevice physDevice)
+{
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, 0);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, queueFamilies.data());
+
+	QueueFamilyIndices indices;
+	for(int x = 0; x < queueFamilyCount; ++x)
+	{
+		if(!queueFamilies[x].queueCount)
+		{
+			continue;
+		}
+
+		VkBool32 presentSupport = VK_FALSE;
+		if(!headless)
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(physDevice, x, surface, &presentSupport);
+		}
+
+		const VkQueueFlags flags = queueFamilies[x].queueFlags;
+		if(flags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			//prefer a family that can also present
+			if(indices.graphics == -1 || (presentSupport && indices.present != indices.graphics))
+			{
+				indices.graphics = x;
+			}
+			if(presentSupport)
+			{
+				indices.present = x;
+			}
+		}
+		else if(presentSupport && indices.present == -1)
+		{
+			indices.present = x;
+		}
+
+		//dma engines expose transfer only families, they copy without taking time from the graphics queue
+		if(flags & VK_QUEUE_TRANSFER_BIT && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.transfer = x;
+		}
+
+		//a compute family without graphics runs dispatches alongside rendering
+		if(flags & VK_QUEUE_COMPUTE_BIT && !(flags & VK_QUEUE_GRAPHICS_BIT) && indices.compute == -1)
+		{
+			indices.compute = x;
+		}
+	}
+
+	if(indices.transfer == -1)
+	{
+		indices.transfer = indices.graphics;
+	}
+	if(indices.compute == -1)
+	{
+		indices.compute = indices.graphics;
+	}
+	return indices;
+}
+
+
+bool Vulkan::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, Allocation &allocation,
+						  AllocationStrategy strategy)
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if(!allocator.CreateBuffer(bufferInfo, properties, strategy, buffer, allocation))
+	{
+		std::cout << "Couldn't create buffer of " << size << " bytes\n";
+		return false;
+	}
+	return true;
+}
+
+
+void Vulkan::QueueUpload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	if(!dst)
+	{
+		return; //its CreateBuffer failed and said so
+	}
+
+	//16 byte aligned so any copy offset stays valid
+	const auto AlignedUsed = [](const StagingChunk &chunk) { return (chunk.used + 15) & ~VkDeviceSize(15); };
+
+	if(stagingChunks.empty() || AlignedUsed(stagingChunks.back()) + size > stagingChunks.back().size)
+	{
+		StagingChunk chunk = {};
+		chunk.size = std::max(size, stagingChunkSize);
+		if(!CreateBuffer(chunk.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+						 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, chunk.buffer, chunk.allocation))
+		{
+			//dst keeps its old contents, nothing is queued for it
+			std::cout << "Couldn't stage " << size << " bytes for upload\n";
+			return;
+		}
+		chunk.mapped = static_cast<uint8_t*>(chunk.allocation.mapped);
+		stagingChunks.push_back(chunk);
+	}
+
+	StagingChunk &chunk = stagingChunks.back();
+	const VkDeviceSize srcOffset = AlignedUsed(chunk);
+	std::memcpy(chunk.mapped + srcOffset, data, size);
+	chunk.used = srcOffset + size;
+
+	pendingCopies.push_back({chunk.buffer, dst, {srcOffset, dstOffset, size}});
+}
+
+
+void Vulkan::FlushUploads()
+{
+	if(pendingCopies.empty())
+	{
+		return;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = transferCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	UploadBatch batch = {};
+	vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+	for(const auto &v : pendingCopies)
+	{
+		vkCmdCopyBuffer(batch.commandBuffer, v.src, v.dst, 1, &v.region);
+	}
+
+	const VkAccessFlags readAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	const VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	if(queueFamilies.transfer == queueFamilies.graphics)
+	{
+		//same queue, a barrier makes the copies visible to every later submission
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = readAccess;
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 1, &barrier, 0, 0, 0, 0);
 	}
-	for(auto &v : swapchainImageViews)
+	else
 	{
-		if(v)
+		//exclusive buffers written on the transfer family are released here and acquired by graphics.
+		//both halves need identical barriers, the acquire is submitted with the next frame
+		std::vector<VkBufferMemoryBarrier> barriers(pendingCopies.size());
+		for(uint32_t x = 0; x < pendingCopies.size(); ++x)
 		{
-			vkDestroyImageView(device, v, 0);
+			barriers[x].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barriers[x].srcQueueFamilyIndex = queueFamilies.transfer;
+			barriers[x].dstQueueFamilyIndex = queueFamilies.graphics;
+			barriers[x].buffer = pendingCopies[x].dst;
+			barriers[x].offset = pendingCopies[x].region.dstOffset;
+			barriers[x].size = pendingCopies[x].region.size;
+			barriers[x].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers[x].dstAccessMask = 0;
 		}
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+							 0, 0, 0, barriers.size(), barriers.data(), 0, 0);
+
+		PendingAcquire acquire = {};
+		allocInfo.commandPool = commandPool;
+		vkAllocateCommandBuffers(device, &allocInfo, &acquire.commandBuffer);
+		vkBeginCommandBuffer(acquire.commandBuffer, &beginInfo);
+		for(auto &v : barriers)
+		{
+			v.srcAccessMask = 0;
+			v.dstAccessMask = readAccess;
+		}
+		vkCmdPipelineBarrier(acquire.commandBuffer, readStages, readStages,
+							 0, 0, 0, barriers.size(), barriers.data(), 0, 0);
+		vkEndCommandBuffer(acquire.commandBuffer);
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		vkCreateSemaphore(device, &semaphoreInfo, 0, &acquire.semaphore);
+
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &acquire.semaphore;
+		pendingAcquires.push_back(acquire);
 	}
-	if(swapchain)
-	{
-		vkDestroySwapchainKHR(device, swapchain, 0);
-	}
-	if(surface)
+
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	vkCreateFence(device, &fenceInfo, 0, &batch.fence);
+
+	vkQueueSubmit(transferQueue, 1, &submitInfo, batch.fence);
+
+	batch.chunks.swap(stagingChunks);
+	uploadBatches.push_back(std::move(batch));
+	pendingCopies.clear();
+}
+
+
+void Vulkan::RetireUploads(bool wait)
+{
+	for(auto it = uploadBatches.begin(); it != uploadBatches.end();)
 	{
-		vkDestroySurfaceKHR(instance, surface, 0);
+		if(wait)
+		{
+			vkWaitForFences(device, 1, &it->fence, VK_TRUE, 0xFFFFFFFFFFFFFFFF);
+		}
+		else if(vkGetFenceStatus(device, it->fence) != VK_SUCCESS)
+		{
+			++it;
+			continue;
+		}
+
+		vkDestroyFence(device, it->fence, 0);
+		vkFreeCommandBuffers(device, transferCommandPool, 1, &it->commandBuffer);
+		for(auto &v : it->chunks)
+		{
+			allocator.DestroyBuffer(v.buffer, v.allocation);
+		}
+		it = uploadBatches.erase(it);
 	}
-	if(device)
+}
+
+
+void Vulkan::CreateShaderModule(const std::string &name, VkShaderModule &module)
+{
+	ShaderCode shader = GetEmbeddedShader(name);
+
+	MappedFile shaderFile;
+	if(!shaderDir.empty())
 	{
-		vkDestroyDevice(device, 0);
+		const std::string path = shaderDir + "/" + name + ".spv";
+		const FileError error = shaderFile.Open(path);
+		if(error == FileError::None && shaderFile.Words())
+		{
+			shader = {shaderFile.Words(), shaderFile.Size()};
+		}
+		else
+		{
+			std::cout << path << ": " << (error != FileError::None ? FileErrorString(error) : "not a multiple of 4 bytes")
+					  << ", using the embedded shader\n";
+		}
 	}
-	if(instance)
+
+	if(!shader.code)
 	{
-		vkDestroyInstance(instance, 0);
+		std::cout << "Shader " << name << " not found!\n";
+		module = VK_NULL_HANDLE;
+		return;
 	}
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+	createInfo.codeSize = shader.size;
+	createInfo.pCode = shader.code;
+
+	vkCreateShaderModule(device, &createInfo, 0, &module);
 }
 
 
-std::vector<const char*> Vulkan::GetRequiredExtensions()
+VkVertexInputBindingDescription Vertex::GetBindingDescription()
 {
-	std::vector<const char*> extensions;
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(Vertex);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-	uint32_t glfwExtensionCount;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	return bindingDescription;
+}
 
-	for(uint32_t x = 0; x < glfwExtensionCount; ++x)
-	{
-		extensions.push_back(glfwExtensions[x]);
-	}
 
-	if(enableValidationLayers)
-	{
-		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
-	}
+std::array<VkVertexInputAttributeDescription, 2> Vertex::GetAttributeDescriptions()
+{
+	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+	return attributeDescriptions;
+}
 
-	return extensions;
+
+VkVertexInputBindingDescription Particle::GetBindingDescription()
+{
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(Particle);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return bindingDescription;
 }
 
 
-bool Vulkan::IsDeviceSuitable(VkPhysicalDevice physDevice)
+std::array<VkVertexInputAttributeDescription, 2> Particle::GetAttributeDescriptions()
 {
-	// for(const auto &v : devices)
-	// {
-		// VkPhysicalDeviceProperties deviceProperties;
-		// vkGetPhysicalDeviceProperties(v, &deviceProperties);
-		// VkPhysicalDeviceFeatures deviceFeatures;
-		// vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+	attributeDescriptions[0].binding = 0;
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[0].offset = offsetof(Particle, pos);
+
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(Particle, velocity);
+
+	return attributeDescriptions;
+}
 
-		// if(deviceFeatures.geometryShader)
-		// {
-			// std::cout << "suitability test";
-		// }
-	// }
 
-	int suitableQueue = FindQueueFamily(physDevice);
+VkVertexInputBindingDescription InstanceData::GetBindingDescription()
+{
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = 1;
+	bindingDescription.stride = sizeof(InstanceData);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-	bool extensionsSupported = CheckDeviceExtensionSupport(physDevice);
-	bool swapchainGood = false;
-	if(extensionsSupported)
+	return bindingDescription;
+}
+
+
+std::array<VkVertexInputAttributeDescription, 3> InstanceData::GetAttributeDescriptions()
+{
+	std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
+	attributeDescriptions[0].binding = 1;
+	attributeDescriptions[0].location = 2;
+	attributeDescriptions[0].format = VK_FORMAT_R16G16_SNORM;
+	attributeDescriptions[0].offset = offsetof(InstanceData, pos);
+
+	attributeDescriptions[1].binding = 1;
+	attributeDescriptions[1].location = 3;
+	attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(InstanceData, scale);
+
+	attributeDescriptions[2].binding = 1;
+	attributeDescriptions[2].location = 4;
+	attributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+	attributeDescriptions[2].offset = offsetof(InstanceData, color);
+
+	return attributeDescriptions;
+}
+
+
+void Vulkan::DeferDestroy(std::function<void()> &&destroy)
+{
+	deferredDestroys.push_back({frameNumber, std::move(destroy)});
+}
+
+
+void Vulkan::RunDeferredDestroys(bool all)
+{
+	//called after waiting on this frame's fence, so every frame up to frameNumber - maxFramesInFlight has retired
+	while(!deferredDestroys.empty() && (all || deferredDestroys.front().frame + maxFramesInFlight <= frameNumber + 1))
 	{
-		SwapchainSupportDetails swapchainSupport = QuerySwapchainSupport(physDevice);
-		swapchainGood = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
+		deferredDestroys.front().destroy();
+		deferredDestroys.pop_front();
 	}
-
-	return suitableQueue != -1 && extensionsSupported && swapchainGood;
 }
 
 
-bool Vulkan::CheckDeviceExtensionSupport(VkPhysicalDevice physDevice)
+uint32_t Vulkan::RecordingSlotCount() const
 {
-	uint32_t extensionCount;
-	vkEnumerateDeviceExtensionProperties(physDevice, 0, &extensionCount, 0);
+	return recordMode == RecordMode::Prerecorded ? swapchainImages.size() : std::max(maxFramesInFlight, 1u);
+}
 
-	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-	vkEnumerateDeviceExtensionProperties(physDevice, 0, &extensionCount, availableExtensions.data());
 
-	bool extensionSupport = true;
-	for(const auto &v : deviceExtensions)
+void Vulkan::RecordDraws(VkCommandBuffer cmd, uint32_t slot, uint32_t firstDraw, uint32_t drawCount)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+	//bound once, nothing in the draw loop touches descriptors
+	const std::array<VkDescriptorSet, 2> sets{frameUniforms.set, resourceSet};
+	const uint32_t frameOffset = frameUniforms.ring.SlotOffset(slot);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, sets.size(), sets.data(), 1, &frameOffset);
+
+	//dynamic state isn't inherited, every secondary buffer sets its own
+	const VkViewport viewport = {0.0f, 0.0f, float(swapchainExtent.width), float(swapchainExtent.height), 0.0f, 1.0f};
+	const VkRect2D scissor = {{0, 0}, swapchainExtent};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	//culled draws take their instances from the packed survivors
+	const std::array<VkBuffer, 2> vertexBuffers{vertexBuffer, gpuCulling ? cull.visible[slot] : instanceBuffer};
+	const std::array<VkDeviceSize, 2> offsets{0, 0};
+	vkCmdBindVertexBuffers(cmd, 0, instanceCount ? 2 : 1, vertexBuffers.data(), offsets.data());
+	vkCmdBindIndexBuffer(cmd, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+	for(uint32_t x = firstDraw; x < firstDraw + drawCount; ++x)
 	{
-		bool extensionFound = false;
-		for(const auto &w : availableExtensions)
+		DrawConstants constants;
+		std::memcpy(constants.tint, drawList[x].tint, sizeof(constants.tint));
+		constants.textureIndex = textures.TableIndex(drawList[x].texture);
+		vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+		if(gpuCulling)
 		{
-			if(std::string(v) == std::string(w.extensionName))
-			{
-				extensionFound = true;
-				break;
-			}
+			vkCmdDrawIndexedIndirect(cmd, cull.commands[slot], x * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
 		}
-		if(extensionFound == false)
+		else
 		{
-			extensionSupport = false;
-			break;
+			vkCmdDrawIndexed(cmd, indexCount, drawList[x].instanceCount, 0, 0, drawList[x].firstInstance);
 		}
 	}
-
-	return extensionSupport;
 }
 
 
-bool Vulkan::CheckValidationLayerSupport()
+void Vulkan::RecordFrame(uint32_t frame, uint32_t imageIndex)
 {
-	uint32_t layerCount;
-	vkEnumerateInstanceLayerProperties(&layerCount, 0);
+	//the fence wait in DrawFrame retired everything recorded from these last time round
+	FrameCommands &commands = frameCommands[frame];
+	vkResetCommandPool(device, commands.pool, 0);
 
-	std::vector<VkLayerProperties> availableLayers(layerCount);
-	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+	//no slices unless recording in parallel
+	const bool parallel = recordMode == RecordMode::Parallel;
+	const uint32_t sliceCount = commands.secondaries.size();
+	const uint32_t drawsPerSlice = sliceCount ? (drawList.size() + sliceCount - 1) / sliceCount : 0;
 
-	for(const auto &v : availableLayers)
+	threadPool.ParallelFor(sliceCount, [&](uint32_t x)
 	{
-		if(std::string(v.layerName) == std::string(validationLayers[0]))
+		vkResetCommandPool(device, commands.workerPools[x], 0);
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = renderGraph.Framebuffer(scenePass, imageIndex);
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		const uint32_t first = std::min<uint32_t>(x * drawsPerSlice, drawList.size());
+		const uint32_t count = std::min<uint32_t>(drawsPerSlice, drawList.size() - first);
+
+		vkBeginCommandBuffer(commands.secondaries[x], &beginInfo);
+		RecordDraws(commands.secondaries[x], frame, first, count);
+		if(x == 0)
 		{
-			return true;
+			RecordParticles(commands.secondaries[x]);
 		}
+		vkEndCommandBuffer(commands.secondaries[x]);
+	});
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commands.primary, &beginInfo);
+	profiler.CmdBeginFrame(commands.primary, frame);
+	RecordCull(commands.primary, frame);
+
+	const uint32_t zone = profiler.CmdBeginZone(commands.primary, frame, "render pass");
+	if(parallel)
+	{
+		renderGraph.CmdBeginPass(commands.primary, scenePass, imageIndex, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(commands.primary, sliceCount, commands.secondaries.data());
+	}
+	else
+	{
+		renderGraph.CmdBeginPass(commands.primary, scenePass, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+		RecordDraws(commands.primary, frame, 0, drawList.size());
+		RecordParticles(commands.primary);
 	}
+	renderGraph.CmdEndPass(commands.primary, scenePass, imageIndex);
+	profiler.CmdEndZone(commands.primary, frame, zone);
+	RecordPresent(commands.primary, frame, imageIndex);
 
-	return false;
+	vkEndCommandBuffer(commands.primary);
 }
 
 
-SwapchainSupportDetails Vulkan::QuerySwapchainSupport(VkPhysicalDevice physDevice)
+void Vulkan::RecordParticles(VkCommandBuffer cmd)
 {
-	SwapchainSupportDetails details;
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physDevice, surface, &details.capabilities);
+	if(!particleCount)
+	{
+		return;
+	}
 
-	uint32_t formatCount;
-	vkGetPhysicalDeviceSurfaceFormatsKHR(physDevice, surface, &formatCount, 0);
-	if(formatCount)
+	//still compiling, the simulation keeps running and the particles show up a few frames later
+	if(!particlePipeline)
 	{
-		details.formats.resize(formatCount);
-		vkGetPhysicalDeviceSurfaceFormatsKHR(physDevice, surface, &formatCount, details.formats.data());
+		particlePipeline = PipelineBuilder::TryGet(particlePipelineHandle);
+		if(!particlePipeline)
+		{
+			return;
+		}
 	}
 
-	uint32_t presentModeCount;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(physDevice, surface, &presentModeCount, 0);
-	if(presentModeCount)
+	const VkDeviceSize offset = 0;
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, particlePipeline);
+	vkCmdBindVertexBuffers(cmd, 0, 1, &particleBuffers[particleIndex], &offset);
+	vkCmdDraw(cmd, particleCount, 1, 0, 0);
+}
+
+
+void Vulkan::RecordPresent(VkCommandBuffer cmd, uint32_t slot, uint32_t imageIndex)
+{
+	const uint32_t zone = profiler.CmdBeginZone(cmd, slot, "present pass");
+	renderGraph.CmdBeginPass(cmd, presentPass, imageIndex, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipelineLayout, 0, 1, &presentSet, 0, 0);
+
+	const VkViewport viewport = {0.0f, 0.0f, float(swapchainExtent.width), float(swapchainExtent.height), 0.0f, 1.0f};
+	const VkRect2D scissor = {{0, 0}, swapchainExtent};
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+	vkCmdDraw(cmd, 3, 1, 0, 0);
+
+	renderGraph.CmdEndPass(cmd, presentPass, imageIndex);
+	profiler.CmdEndZone(cmd, slot, zone);
+}
+
+
+void Vulkan::CreateCullPipeline()
+{
+	//what each draw covers, the stress scene, its survivors and the draws' indirect commands
+	std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+	for(uint32_t x = 0; x < bindings.size(); ++x)
 	{
-		details.presentModes.resize(presentModeCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(physDevice, surface, &presentModeCount, details.presentModes.data());
+		bindings[x].binding = x;
+		bindings[x].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[x].descriptorCount = 1;
+		bindings[x].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 	}
 
-	return details;
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = bindings.size();
+	layoutInfo.pBindings = bindings.data();
+	vkCreateDescriptorSetLayout(device, &layoutInfo, 0, &cullSetLayout);
+
+	//item count, draw count
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = 2 * sizeof(uint32_t);
+
+	//set 0 is the frame's uniforms, for the view
+	const std::array<VkDescriptorSetLayout, 2> setLayouts{frameSetLayout, cullSetLayout};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = setLayouts.size();
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	vkCreatePipelineLayout(device, &pipelineLayoutInfo, 0, &cullPipelineLayout);
+
+	VkShaderModule cullShaderModule;
+	CreateShaderModule("cull.comp", cullShaderModule);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = cullShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = cullPipelineLayout;
+	vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, 0, &cullPipeline);
+	vkDestroyShaderModule(device, cullShaderModule, 0);
 }
 
 
-VkSurfaceFormatKHR Vulkan::ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats)
+void Vulkan::CreateCullBuffers()
 {
-	if(verbose)
+	//frames in flight may still cull into or draw from the old ones
+	if(cull.pool)
 	{
-		std::cout << "Available formats:\n";
-		for(const auto &v : availableFormats)
+		CullBuffers oldCull = cull;
+		DeferDestroy([this, oldCull]() mutable
 		{
-			std::cout << "  Format: " << v.format << " Colorspace: " << v.colorSpace << "\n";
-		}
+			oldCull.Destroy(device, allocator);
+		});
 	}
+	cull = CullBuffers();
 
-	for(const auto &v : availableFormats)
+	//every draw's survivors are packed from visibleBase on, which is also where its command starts drawing
+	struct CullDraw
 	{
-		if(v.format == VK_FORMAT_B8G8R8A8_UNORM && v.colorSpace == false)
+		uint32_t firstInstance, instanceCount, visibleBase;
+	};
+	std::vector<CullDraw> draws;
+	std::vector<VkDrawIndexedIndirectCommand> commands;
+	for(const auto &v : drawList)
+	{
+		draws.push_back({v.firstInstance, v.instanceCount, cull.itemCount});
+		commands.push_back({indexCount, 0, 0, 0, cull.itemCount});
+		cull.itemCount += v.instanceCount;
+	}
+
+	//small and rewritten whole with the draw list, the gpu reads them straight from host memory
+	const VkDeviceSize drawsSize = sizeof(CullDraw) * std::max<size_t>(draws.size(), 1);
+	const VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * std::max<size_t>(commands.size(), 1);
+	const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	CreateBuffer(drawsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, cull.draws, cull.drawsAllocation);
+	CreateBuffer(commandsSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible, cull.commandTemplate, cull.templateAllocation);
+	std::memcpy(cull.drawsAllocation.mapped, draws.data(), sizeof(CullDraw) * draws.size());
+	std::memcpy(cull.templateAllocation.mapped, commands.data(), sizeof(VkDrawIndexedIndirectCommand) * commands.size());
+
+	const uint32_t slotCount = RecordingSlotCount();
+	const VkDeviceSize visibleSize = sizeof(InstanceData) * std::max(cull.itemCount, 1u);
+	cull.visible.resize(slotCount);
+	cull.commands.resize(slotCount);
+	cull.visibleAllocations.resize(slotCount);
+	cull.commandAllocations.resize(slotCount);
+	for(uint32_t x = 0; x < slotCount; ++x)
+	{
+		CreateBuffer(visibleSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+					 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cull.visible[x], cull.visibleAllocations[x]);
+		CreateBuffer(commandsSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cull.commands[x], cull.commandAllocations[x]);
+	}
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = slotCount * 4;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = slotCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	vkCreateDescriptorPool(device, &poolInfo, 0, &cull.pool);
+
+	const std::vector<VkDescriptorSetLayout> setLayouts(slotCount, cullSetLayout);
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = cull.pool;
+	setInfo.descriptorSetCount = slotCount;
+	setInfo.pSetLayouts = setLayouts.data();
+	cull.sets.resize(slotCount);
+	vkAllocateDescriptorSets(device, &setInfo, cull.sets.data());
+
+	for(uint32_t x = 0; x < slotCount; ++x)
+	{
+		const std::array<VkDescriptorBufferInfo, 4> buffers
+		{{
+			{cull.draws, 0, VK_WHOLE_SIZE},
+			{instanceBuffer, 0, VK_WHOLE_SIZE},
+			{cull.visible[x], 0, VK_WHOLE_SIZE},
+			{cull.commands[x], 0, VK_WHOLE_SIZE},
+		}};
+
+		std::array<VkWriteDescriptorSet, 4> writes = {};
+		for(uint32_t y = 0; y < writes.size(); ++y)
 		{
-			return v;
+			writes[y].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[y].dstSet = cull.sets[x];
+			writes[y].dstBinding = y;
+			writes[y].descriptorCount = 1;
+			writes[y].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[y].pBufferInfo = &buffers[y];
 		}
+		vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, 0);
 	}
+}
 
-	std::cout << "i don't know what format this is... format:"
-			  << availableFormats[0].format << " colorspace:" << availableFormats[0].colorSpace << "\n";
-	return availableFormats[0];	
+
+void Vulkan::CullBuffers::Destroy(VkDevice device, DeviceAllocator &allocator)
+{
+	allocator.DestroyBuffer(draws, drawsAllocation);
+	allocator.DestroyBuffer(commandTemplate, templateAllocation);
+	for(uint32_t x = 0; x < visible.size(); ++x)
+	{
+		allocator.DestroyBuffer(visible[x], visibleAllocations[x]);
+		allocator.DestroyBuffer(commands[x], commandAllocations[x]);
+	}
+	if(pool)
+	{
+		vkDestroyDescriptorPool(device, pool, 0);
+	}
+	*this = CullBuffers();
 }
 
 
-VkPresentModeKHR Vulkan::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes)
+void Vulkan::RecordCull(VkCommandBuffer cmd, uint32_t slot)
 {
-	if(verbose)
+	if(!gpuCulling || drawList.empty())
 	{
-		const std::array<std::string, 4> presentModeNames
-		{
-			"VK_PRESENT_MODE_IMMEDIATE_KHR", "VK_PRESENT_MODE_MAILBOX_KHR",
-			"VK_PRESENT_MODE_FIFO_KHR", "VK_PRESENT_MODE_FIFO_RELAXED_KHR"
-		};
-		std::cout << "presentation engine modes:\n";
-		for(const auto &v : availablePresentModes)
-		{
-			std::cout << "  " << presentModeNames[v] << "\n";
-		}
+		return;
 	}
 
-	return VK_PRESENT_MODE_FIFO_KHR;
+	const uint32_t zone = profiler.CmdBeginZone(cmd, slot, "cull");
+
+	//every draw starts out with no instances, the cull shader counts its survivors in
+	const VkBufferCopy region = {0, 0, sizeof(VkDrawIndexedIndirectCommand) * drawList.size()};
+	vkCmdCopyBuffer(cmd, cull.commandTemplate, cull.commands[slot], 1, &region);
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+	const std::array<VkDescriptorSet, 2> sets{frameUniforms.set, cull.sets[slot]};
+	const uint32_t frameOffset = frameUniforms.ring.SlotOffset(slot);
+	const std::array<uint32_t, 2> counts{cull.itemCount, uint32_t(drawList.size())};
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, sets.size(), sets.data(), 1, &frameOffset);
+	vkCmdPushConstants(cmd, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(counts), counts.data());
+	vkCmdDispatch(cmd, (cull.itemCount + 255) / 256, 1, 1);
+
+	//the draws read the counts as indirect commands and the survivors as instance attributes
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+						 0, 1, &barrier, 0, 0, 0, 0);
+
+	profiler.CmdEndZone(cmd, slot, zone);
 }
 
 
-VkExtent2D Vulkan::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities)
+void Vulkan::SubmitCompute()
 {
-	// std::cout << capabilities.currentExtent.width << " " << capabilities.currentExtent.height << "\n";
-	// std::cout << capabilities.maxImageExtent.width << " " << capabilities.maxImageExtent.height << "\n";
-	if(capabilities.currentExtent.width != 0xFFFFFFFF)
+	//frame N + 1's dispatch goes in while graphics may still be drawing frame N
+	particleIndex = frameNumber % particleBuffers.size();
+
+	VkCommandBuffer cmd = computeCommandBuffers[currentFrame];
+	vkResetCommandPool(device, computePools[currentFrame], 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(cmd, &beginInfo);
+
+	//the previous dispatch wrote what this one reads
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+	struct
 	{
-		return capabilities.currentExtent;
-	}
-	else
+		float dt;
+		uint32_t count, reset;
+	} simulation = {1.0f / 60.0f, particleCount, frameNumber == 0};
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &particleDescriptorSets[particleIndex], 0, 0);
+	vkCmdPushConstants(cmd, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(simulation), &simulation);
+	vkCmdDispatch(cmd, (particleCount + 255) / 256, 1, 1);
+	vkEndCommandBuffer(cmd);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmd;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &computeFinishedSemaphores[currentFrame];
+
+	ProfileScope scope(profiler, "compute submit");
+	vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+}
+
+
+bool Vulkan::CreateFrameUniforms(uint32_t slotCount)
+{
+	//without a ring nothing below has a buffer to point at, DrawFrame finds no slot to write to
+	if(!frameUniforms.ring.Create(allocator, physicalDevice, slotCount, uniformSlotSize))
 	{
-		return {800,600};
+		std::cout << "Couldn't create the frame uniforms for " << slotCount << " slots\n";
+		return false;
 	}
+
+	//written once, the per frame part is the dynamic offset
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	vkCreateDescriptorPool(device, &poolInfo, 0, &frameUniforms.pool);
+
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = frameUniforms.pool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &frameSetLayout;
+	vkAllocateDescriptorSets(device, &setInfo, &frameUniforms.set);
+
+	const VkDescriptorBufferInfo bufferInfo = {frameUniforms.ring.Buffer(), 0, sizeof(FrameData)};
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = frameUniforms.set;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, 0);
+	return true;
 }
 
-int Vulkan::FindQueueFamily(VkPhysicalDevice physDevice)
+
+void Vulkan::CreatePipelineCache()
 {
-	uint32_t queueFamilyCount;
-	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, 0);
+	MappedFile cacheFile;
+	const uint8_t* cacheData = 0;
+	size_t cacheSize = 0;
+	if(!pipelineCachePath.empty() && cacheFile.Open(pipelineCachePath) == FileError::None)
+	{
+		//VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, queueFamilies.data());
+		bool valid = cacheFile.Size() >= 16 + VK_UUID_SIZE;
+		if(valid)
+		{
+			uint32_t header[4];
+			std::memcpy(header, cacheFile.Data(), sizeof(header));
+			valid = header[0] >= 16 + VK_UUID_SIZE && header[0] <= cacheFile.Size()
+				&& header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+				&& header[2] == properties.vendorID && header[3] == properties.deviceID
+				&& std::memcmp(cacheFile.Data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
 
-	int graphicsFamily = -1;
-	// int presentFamily = -1; //find a queue with both graphics and present for now
-	for(int x = 0; x < queueFamilyCount; ++x)
-	{
-		VkBool32 presentSupport;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physDevice, x, surface, &presentSupport);
-		if(queueFamilies[x].queueCount > 0 && queueFamilies[x].queueFlags & VK_QUEUE_GRAPHICS_BIT && presentSupport)
+		if(valid)
 		{
-			graphicsFamily = x;
-			break;
+			cacheData = cacheFile.Data();
+			cacheSize = cacheFile.Size();
+		}
+		else
+		{
+			std::cout << pipelineCachePath << " is stale or corrupt, starting with an empty pipeline cache\n";
 		}
 	}
 
-	return graphicsFamily;
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = cacheSize;
+	cacheInfo.pInitialData = cacheData;
+
+	if(vkCreatePipelineCache(device, &cacheInfo, 0, &pipelineCache) != VK_SUCCESS)
+	{
+		//the driver may still reject data that passed the header check
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = 0;
+		vkCreatePipelineCache(device, &cacheInfo, 0, &pipelineCache);
+	}
 }
 
 
-void Vulkan::CreateShaderModule(const std::vector<uint32_t> &code, VkShaderModule &module)
+void Vulkan::SavePipelineCache()
 {
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	if(pipelineCachePath.empty())
+	{
+		return;
+	}
 
-	createInfo.codeSize = code.size() * 4;
-	createInfo.pCode = (uint32_t*)code.data();
+	size_t size;
+	vkGetPipelineCacheData(device, pipelineCache, &size, 0);
+	std::vector<uint8_t> cacheData(size);
+	if(vkGetPipelineCacheData(device, pipelineCache, &size, cacheData.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+	cacheData.resize(size);
 
-	vkCreateShaderModule(device, &createInfo, 0, &module);
+	if(!U8VecToFile(pipelineCachePath, cacheData))
+	{
+		std::cout << "Writing " << pipelineCachePath << " failed!\n";
+	}
 }
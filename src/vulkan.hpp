@@ -3,6 +3,21 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "allocator.hpp"
+#include "descriptors.hpp"
+#include "pipelines.hpp"
+#include "profiler.hpp"
+#include "rendergraph.hpp"
+#include "textures.hpp"
+#include "threadpool.hpp"
+#include "uniforms.hpp"
+
 
 struct SwapchainSupportDetails
 {
@@ -11,54 +26,356 @@ struct SwapchainSupportDetails
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+struct QueueFamilyIndices
+{
+	int graphics = -1;
+	int present = -1; //same as graphics whenever one family can do both
+	int transfer = -1; //a transfer only family when the device has one, otherwise graphics
+	int compute = -1; //a compute family without graphics (async compute) when there is one, otherwise graphics
+
+	bool IsComplete(bool headless) const { return graphics != -1 && (headless || present != -1); }
+};
+
+struct Vertex
+{
+	float pos[2];
+	float color[3];
+
+	static VkVertexInputBindingDescription GetBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions();
+};
+
+//simulated on the gpu and read back as a vertex buffer to draw points
+struct Particle
+{
+	float pos[2];
+	float velocity[2];
+
+	static VkVertexInputBindingDescription GetBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions();
+};
+
+//12 bytes per instance: snorm16 position, half float scale and rotation, unorm8 colour
+struct InstanceData
+{
+	int16_t pos[2];
+	uint16_t scale, rotation;
+	uint8_t color[4];
+
+	static VkVertexInputBindingDescription GetBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions();
+};
+
+enum class RecordMode
+{
+	Prerecorded, //one primary buffer per swapchain image, recorded once at startup
+	PerFrame, //re-recorded every frame on the calling thread
+	Parallel, //re-recorded every frame, the draw list is split over worker threads into secondary buffers
+};
+
+//what the swapchain's present mode is chosen for, each falls back to the next best mode the surface supports
+enum class PresentPolicy
+{
+	Vsync, //FIFO, always available
+	Throughput, //MAILBOX, then IMMEDIATE
+	LowLatency, //IMMEDIATE, then MAILBOX
+	Adaptive, //FIFO_RELAXED, tears only when a frame is late
+};
+
+bool ParsePresentPolicy(const std::string &name, PresentPolicy &policy);
+
+struct LatencySamples
+{
+	std::vector<double> inputToPresent; //ms from SampleInput to vkQueuePresentKHR returning (vkQueueSubmit when headless)
+	std::vector<double> inputToGpuEnd; //ms from SampleInput to the end of the frame's gpu work, estimated from timestamps
+};
+
+struct DrawCommand
+{
+	uint32_t firstInstance, instanceCount;
+	float tint[4] = {1.0f, 1.0f, 1.0f, 1.0f}; //per draw push constant, multiplies the vertex colour
+	TextureHandle texture = 0xFFFFFFFF; //pushed as its table index, untextured until the preview is resident
+};
+
+//std140 block every vertex shader reads at set 0 binding 0, through a dynamic offset into the uniform ring
+struct FrameData
+{
+	float viewScale[2] = {1.0f, 1.0f}, viewOffset[2] = {0.0f, 0.0f}; //2d view applied to every position
+	float time = 0.0f; //seconds since the first frame
+	float padding[3];
+};
+
 class Vulkan
 {
 	public:
+		//the settings main and benchmark share, parsed into the members below. true when argv[x] was
+		//one of them, x is then left on its last argument
+		bool ParseOption(int argc, char* argv[], int &x);
+		static const char* OptionUsage();
+
 		void CreateInstance();
 		void SetupDebugCallback();
 		void CreateSurface(GLFWwindow* &window);
 		void PickPhysicalDevice();
 		void CreateLogicalDevice();
 		void CreateSwapchain();
+		void CreateOffscreenTarget();
 		void CreateImageViews();
-		void CreateRenderPass();
+		//false when the frame graph doesn't compile, nothing can be drawn then
+		bool CreateRenderPass();
 		void CreateGraphicsPipeline();
 		void CreateFramebuffers();
 		void CreateCommandPool();
+		void CreateVertexBuffers();
+		void CreateParticles();
 		void CreateCommandBuffers();
 		void CreateSemaphores();
 
+		//must stay within the instances created by CreateVertexBuffers. per frame modes pick it up
+		//on the next DrawFrame, prerecorded mode has to wait idle and rerecord every buffer
+		void SetDrawList(const std::vector<DrawCommand> &draws);
+		const std::vector<DrawCommand> &GetDrawList() const { return drawList; }
+
+		//rebuilds the swapchain and everything sized by it, the old one is retired once its frames are done
+		bool RecreateSwapchain();
+		//the input the next frame reacts to was read now, latency is measured from here.
+		//without it DrawFrame uses its own start time
+		void SampleInput();
 		void DrawFrame();
+		void WaitIdle();
 
 		void PrintAvailableExtensions();
+		std::string GetDeviceName();
+		const char* GetPresentModeName() const;
+		const LatencySamples &GetLatencySamples() const { return latency; }
+		AllocatorStats GetMemoryStats() const { return allocator.GetStats(); }
+		//textures and buffers shaders index through set 1, valid after CreateGraphicsPipeline.
+		//without descriptor indexing, prerecorded frames only see what was in it at the last SetDrawList
+		DescriptorTable &GetResourceTable() { return resourceTable; }
+		//loading and residency of streamed textures, valid after CreateCommandPool when texturePaths isn't empty
+		TextureStreamer &GetTextures() { return textures; }
 		void Destroy();
 
 		bool verbose = false;
+#ifdef NDEBUG
+		bool validation = false;
+#else
+		bool validation = true;
+#endif
+		uint32_t maxFramesInFlight = 2;
+		bool headless = false;
+		bool framebufferResized = false; //set from the window's resize callback
+		PresentPolicy presentPolicy = PresentPolicy::Vsync;
+		uint32_t swapchainImageCount = 0; //requested image count, clamped to the surface limits. 0 uses minImageCount + 1
+		bool measureLatency = false; //needs gpu timestamps, so it runs the profiler even without a trace
+		VkExtent2D headlessExtent = {800, 600};
+		std::string pipelineCachePath = "pipeline.cache";
+		std::string tracePath; //chrome trace output, profiling is off when empty
+		std::string shaderDir; //load <name>.spv from here instead of the embedded shaders
+		std::string deviceOverride; //index or part of the device name, VKG_DEVICE is used when empty
+		uint32_t instanceCount = 0; //stress scene with this many instanced triangles, 0 draws the single triangle
+		uint32_t instancesPerDraw = 0; //splits the stress scene into draws of this many instances, 0 draws it all at once
+		bool gpuCulling = false; //the stress scene is culled against the view by a compute shader and drawn indirectly
+		RecordMode recordMode = RecordMode::Prerecorded;
+		uint32_t workerCount = 0; //recording threads for RecordMode::Parallel, 0 uses one per hardware thread
+		uint32_t particleCount = 0; //simulated by a compute shader on the compute queue, needs a per frame record mode
+		float particleHotSpeed = 1.0f; //speed drawn fully hot, a specialization constant of the particle pipeline
+		uint32_t pipelineThreads = 0; //pipeline compile threads, 0 uses one per hardware thread
+		FrameData frameData; //copied into this frame's uniform slot by DrawFrame, which fills in the time
+		bool bindless = false; //resource table with descriptor indexing, cleared by CreateLogicalDevice when unsupported
+		uint32_t tableImageCapacity = 4096, tableBufferCapacity = 1024; //clamped to the device limits by the table
+		std::vector<std::string> texturePaths; //ppm or tga, streamed in while frames are drawn. draws take them in turn
+		VkDeviceSize textureBudget = 4 << 20; //texture bytes uploaded per frame at most
+		uint32_t textureThreads = 2; //decode threads, 0 uses one per hardware thread
 
 	private:
 		std::vector<const char*> GetRequiredExtensions();
 		bool IsDeviceSuitable(VkPhysicalDevice physDevice);
-		bool CheckDeviceExtensionSupport(VkPhysicalDevice physDevice);
+		uint64_t ScoreDevice(VkPhysicalDevice physDevice);
+		bool CheckDeviceExtensionSupport(VkPhysicalDevice physDevice, const std::vector<const char*> &extensions);
+		bool CheckBindlessSupport(VkPhysicalDevice physDevice);
 		bool CheckValidationLayerSupport();
 		SwapchainSupportDetails QuerySwapchainSupport(VkPhysicalDevice physDevice);
 		VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
 		VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes);
 		VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
-		int FindQueueFamily(VkPhysicalDevice physDevice);
-		void CreateShaderModule(const std::vector<uint32_t> &code, VkShaderModule &module);
+		QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physDevice);
+		bool CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, Allocation &allocation,
+						  AllocationStrategy strategy = AllocationStrategy::FreeList);
+		void QueueUpload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+		void FlushUploads();
+		void RetireUploads(bool wait);
+		void CreateShaderModule(const std::string &name, VkShaderModule &module);
+		uint32_t RecordingSlotCount() const;
+		void RecordDraws(VkCommandBuffer cmd, uint32_t slot, uint32_t firstDraw, uint32_t drawCount);
+		void DeferDestroy(std::function<void()> &&destroy);
+		void RunDeferredDestroys(bool all);
+		void UpdateResourceSet();
+		void RecordPrerecorded();
+		void RecordFrame(uint32_t frame, uint32_t imageIndex);
+		void RecordParticles(VkCommandBuffer cmd);
+		void CreatePresentSet();
+		void RecordPresent(VkCommandBuffer cmd, uint32_t slot, uint32_t imageIndex);
+		void CreateCullPipeline();
+		void CreateCullBuffers();
+		void RecordCull(VkCommandBuffer cmd, uint32_t slot);
+		void SubmitCompute();
+		bool CreateFrameUniforms(uint32_t slotCount);
+		void CreatePipelineCache();
+		void SavePipelineCache();
 
 		const std::vector<const char*> validationLayers{"VK_LAYER_LUNARG_standard_validation"};
 		const std::vector<const char*> deviceExtensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 		std::vector<VkImage> swapchainImages;
 		std::vector<VkImageView> swapchainImageViews;
+		std::vector<Allocation> offscreenImageAllocations;
 		//
-		std::vector<VkFramebuffer> swapchainFramebuffers;
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VkSemaphore> imageAvailableSemaphores, renderFinishedSemaphores;
+		std::vector<VkFence> inFlightFences, imagesInFlight;
+		uint32_t currentFrame = 0;
+		uint64_t frameNumber = 0; //frames submitted so far
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+		Profiler::Clock::time_point inputTime;
+		bool inputSampled = false;
+		std::vector<Profiler::Clock::time_point> slotInputTimes; //input time of the last submission per recording slot
+		LatencySamples latency;
+
+		//objects that may still be used by frames in flight, destroyed once every frame
+		//submitted before they were queued has retired
+		struct DeferredDestroy
+		{
+			uint64_t frame;
+			std::function<void()> destroy;
+		};
+		std::deque<DeferredDestroy> deferredDestroys;
+
+		std::vector<DrawCommand> drawList;
+
+		//per frame uniforms, one ring slot per recording slot. recorded binds point at the start of
+		//their slot, so prerecorded buffers see new data every frame without being rerecorded
+		struct FrameUniforms
+		{
+			UniformRing ring;
+			VkDescriptorPool pool = 0;
+			VkDescriptorSet set = 0;
+		};
+		FrameUniforms frameUniforms;
+		VkDescriptorSetLayout frameSetLayout = 0;
+		const VkDeviceSize uniformSlotSize = 64 << 10;
+		Profiler::Clock::time_point firstFrameTime;
+
+		DescriptorTable resourceTable;
+		DescriptorAllocator frameDescriptors; //per frame copies of the table when it isn't bindless
+		struct FrameResources
+		{
+			VkDescriptorSet set = 0;
+			uint32_t version = 0; //of the table when set was written
+		};
+		std::vector<FrameResources> frameResources; //per frame in flight, from frameDescriptors
+		bool tableSetWritten = false; //the table's own set, what prerecorded buffers bind without descriptor indexing
+		VkDescriptorSet resourceSet = 0; //what the frame being recorded binds as set 1
+		bool physicalDeviceProperties2 = false; //instance extension enabled, for querying descriptor indexing
+
+		TextureStreamer textures;
+		std::vector<TextureHandle> textureHandles; //one per texturePaths entry
+
+		//transient pools for recording every frame, one set per frame in flight. slice x of the
+		//draw list is only ever recorded from workerPools[x], so no pool is used by two threads at once
+		struct FrameCommands
+		{
+			VkCommandPool pool = 0;
+			VkCommandBuffer primary = 0;
+			std::vector<VkCommandPool> workerPools;
+			std::vector<VkCommandBuffer> secondaries;
+		};
+		std::vector<FrameCommands> frameCommands;
+		ThreadPool threadPool;
+
+		//uploads are written straight into mapped staging chunks and copied
+		//to their device local destinations by one submission in FlushUploads
+		struct StagingChunk
+		{
+			VkBuffer buffer;
+			Allocation allocation;
+			VkDeviceSize size, used;
+			uint8_t* mapped;
+		};
+		struct PendingCopy
+		{
+			VkBuffer src, dst;
+			VkBufferCopy region;
+		};
+		std::vector<StagingChunk> stagingChunks;
+		std::vector<PendingCopy> pendingCopies;
+		const VkDeviceSize stagingChunkSize = 4 << 20;
+
+		//a flushed batch runs on the transfer queue while frames keep going, its staging
+		//memory is released once the fence is seen signalled
+		struct UploadBatch
+		{
+			VkCommandBuffer commandBuffer;
+			VkFence fence;
+			std::vector<StagingChunk> chunks;
+		};
+		//with a separate transfer family the graphics queue has to acquire ownership
+		//of the uploaded buffers, the next frame submits this first and waits on the semaphore
+		struct PendingAcquire
+		{
+			VkCommandBuffer commandBuffer;
+			VkSemaphore semaphore;
+		};
+		std::vector<UploadBatch> uploadBatches;
+		std::vector<PendingAcquire> pendingAcquires;
+
+		VkBuffer vertexBuffer = 0, indexBuffer = 0, instanceBuffer = 0;
+		Allocation vertexAllocation, indexAllocation, instanceAllocation;
+
+		//one more state buffer than frames in flight, so the dispatch for the next frame never
+		//writes a buffer that a frame still in flight draws from. set x reads x - 1 and writes x
+		std::vector<VkBuffer> particleBuffers;
+		std::vector<Allocation> particleAllocations;
+		std::vector<VkDescriptorSet> particleDescriptorSets;
+		std::vector<VkCommandPool> computePools; //per frame in flight
+		std::vector<VkCommandBuffer> computeCommandBuffers;
+		std::vector<VkSemaphore> computeFinishedSemaphores;
+		uint32_t particleIndex = 0; //state buffer written by this frame's dispatch
+		VkDescriptorSetLayout particleSetLayout = 0;
+		VkDescriptorPool particleDescriptorPool = 0;
+		VkPipelineLayout computePipelineLayout = 0;
+		VkPipeline computePipeline = 0, particlePipeline = 0;
+		PipelineHandle particlePipelineHandle;
+		uint32_t indexCount = 0;
+
+		//gpu culling: one invocation per instance of every draw, survivors are packed into the draw's
+		//own range of visible and counted by an atomic on its indirect command's instanceCount
+		struct CullBuffers
+		{
+			VkBuffer draws = 0, commandTemplate = 0; //host visible, rebuilt with the draw list
+			Allocation drawsAllocation, templateAllocation;
+			std::vector<VkBuffer> visible, commands; //per recording slot
+			std::vector<Allocation> visibleAllocations, commandAllocations;
+			VkDescriptorPool pool = 0;
+			std::vector<VkDescriptorSet> sets;
+			uint32_t itemCount = 0;
+
+			void Destroy(VkDevice device, DeviceAllocator &allocator);
+		};
+		CullBuffers cull;
+		VkDescriptorSetLayout cullSetLayout = 0;
+		VkPipelineLayout cullPipelineLayout = 0;
+		VkPipeline cullPipeline = 0;
+
+		DeviceAllocator allocator;
+		Profiler profiler;
 
-		VkQueue graphicsQueue, presentQueue;
+		QueueFamilyIndices queueFamilies;
+		VkQueue graphicsQueue = 0, presentQueue = 0, transferQueue = 0, computeQueue = 0;
 		VkFormat swapchainImageFormat;
 		VkExtent2D swapchainExtent;
 
+		GLFWwindow* window = 0;
 		VkPhysicalDevice physicalDevice = 0;
 		//
 		VkInstance instance = 0;
@@ -66,9 +383,24 @@ class Vulkan
 		VkSurfaceKHR surface = 0;
 		VkSwapchainKHR swapchain = 0;
 		VkPipelineLayout pipelineLayout = 0;
-		VkRenderPass renderPass = 0;
+		RenderGraph renderGraph;
+		GraphResource backbuffer = 0, sceneColor = 0, sceneDepth = 0;
+		uint32_t scenePass = 0, presentPass = 0;
+		VkRenderPass renderPass = 0; //the scene pass's, owned by the graph
+		//copies the scene into the backbuffer. the set points at the current targets' scene image,
+		//so it gets a new pool whenever they're recreated
+		VkDescriptorSetLayout presentSetLayout = 0;
+		VkPipelineLayout presentPipelineLayout = 0;
+		VkSampler presentSampler = 0;
+		VkDescriptorPool presentPool = 0;
+		VkDescriptorSet presentSet = 0;
+		VkPipeline presentPipeline = 0;
+		PipelineHandle presentPipelineHandle;
 		VkPipeline graphicsPipeline = 0;
+		PipelineHandle graphicsPipelineHandle;
+		PipelineBuilder pipelineBuilder;
+		VkPipelineCache pipelineCache = 0;
 		VkCommandPool commandPool = 0;
-		VkSemaphore imageAvailable = 0, renderFinished = 0;
+		VkCommandPool transferCommandPool = 0;
 		VkDebugReportCallbackEXT callback = 0;
 };